@@ -0,0 +1,301 @@
+// run with --benchmark_format=json (or --benchmark_out=<file> --benchmark_out_format=json) to
+// export results, --benchmark_filter=<regex> picks a subset
+
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+#include "benchmark/benchmark.h"
+#include "physenv/Ensemble.hpp"
+#include "physenv/Persistance.hpp"
+#include "physenv/Snapshot.hpp"
+
+using namespace physenv;
+
+namespace {
+
+constexpr double deltaTime = 1.0 / 120;
+
+// n by n softbody resting over the two default polygons
+Engine grid(std::int64_t n) {
+    auto size = static_cast<std::size_t>(n);
+    return Engine::softbody({size, size}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+}
+
+void gridArgs(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMicrosecond);
+}
+
+void setCounters(benchmark::State& state, const Engine& e) {
+    state.counters["points"]  = static_cast<double>(e.points.size());
+    state.counters["springs"] = static_cast<double>(e.springs.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(e.points.size()));
+}
+
+// query positions spread over the grid's bounds
+std::vector<Vec2> queries(std::int64_t n, std::size_t count) {
+    std::mt19937                           gen{42};
+    std::uniform_real_distribution<double> dist{0.0, static_cast<double>(n) * 0.05};
+    std::vector<Vec2>                      out;
+    for (std::size_t i = 0; i != count; ++i) out.emplace_back(0.5 + dist(gen), 1.0 + dist(gen));
+    return out;
+}
+
+// payload for the container benchmarks, PointRef can only come from a store
+Spring spring() {
+    static PointStore store;
+    static PointRef   point = store.insert(Point{});
+    return Spring{1.0, 1.0, 1.0, point, point};
+}
+
+// saveEng logs to std::cout, which would swamp the benchmark output
+struct SilenceCout {
+    std::ostringstream sink;
+    std::streambuf*    old = std::cout.rdbuf(sink.rdbuf());
+    ~SilenceCout() { std::cout.rdbuf(old); }
+};
+
+} // namespace
+
+// engine
+
+void BM_SimFrame(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    for (auto _: state) e.simFrame(deltaTime);
+    setCounters(state, e);
+}
+BENCHMARK(BM_SimFrame)->Apply(gridArgs);
+
+// every island put to sleep after the first frame, what a settled scene costs
+void BM_SimFrameAsleep(benchmark::State& state) {
+    Engine e                   = grid(state.range(0));
+    e.sleeping.enabled         = true;
+    e.sleeping.energyThreshold = std::numeric_limits<double>::infinity();
+    e.sleeping.framesToSleep   = 1;
+    e.simFrame(deltaTime);
+    for (auto _: state) e.simFrame(deltaTime);
+    setCounters(state, e);
+}
+BENCHMARK(BM_SimFrameAsleep)->Apply(gridArgs);
+
+// second argument is Engine::threads
+void BM_SimFrameThreads(benchmark::State& state) {
+    Engine e  = grid(state.range(0));
+    e.threads = static_cast<std::size_t>(state.range(1));
+    for (auto _: state) e.simFrame(deltaTime);
+    setCounters(state, e);
+}
+BENCHMARK(BM_SimFrameThreads)
+    ->ArgsProduct({{100, 1000}, {1, 2, 4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// same grid simulated in float
+void BM_SimFrameFloat(benchmark::State& state) {
+    auto    size = static_cast<std::size_t>(state.range(0));
+    EngineF e    = EngineF::softbody({size, size}, {0.5f, 1.0f}, 9.8f, 0.05f, 100.0f, 1.0f);
+    for (auto _: state) e.simFrame(static_cast<float>(deltaTime));
+    state.counters["points"] = static_cast<double>(e.points.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(e.points.size()));
+}
+BENCHMARK(BM_SimFrameFloat)->Apply(gridArgs);
+
+// 16 members of an n by n grid sweeping the spring constant, second argument is
+// Ensemble::threads
+void BM_Ensemble(benchmark::State& state) {
+    std::vector<MemberParams> params(16);
+    for (std::size_t m = 0; m != params.size(); ++m) {
+        params[m].springScale = 0.5 + 0.1 * static_cast<double>(m);
+    }
+    Ensemble ensemble(grid(state.range(0)), params);
+    ensemble.threads = static_cast<std::size_t>(state.range(1));
+    for (auto _: state) ensemble.simFrame(deltaTime);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(params.size()) *
+                            static_cast<std::int64_t>(ensemble[0].points.size()));
+}
+BENCHMARK(BM_Ensemble)
+    ->ArgsProduct({{30, 100}, {1, 2, 4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+void BM_SpringForces(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    for (auto _: state) e.springForces();
+    state.counters["springs"] = static_cast<double>(e.springs.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(e.springs.size()));
+}
+BENCHMARK(BM_SpringForces)->Apply(gridArgs);
+
+void BM_Integrate(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    for (auto _: state) e.points.update(deltaTime, e.gravity);
+    setCounters(state, e);
+}
+BENCHMARK(BM_Integrate)->Apply(gridArgs);
+
+void BM_Collide(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    for (auto _: state) e.collide();
+    setCounters(state, e);
+}
+BENCHMARK(BM_Collide)->Apply(gridArgs);
+
+// terrain outline with range(0) edges against points just under its surface, the second argument
+// builds the edge index
+void BM_PolygonCollide(benchmark::State& state) {
+    auto surface = [](double x) { return 5 + std::sin(x * 0.7) + 0.5 * std::sin(x * 3.1); };
+    std::vector<Vec2> verts;
+    const auto        n = static_cast<double>(state.range(0) - 2);
+    for (std::int64_t i = 0; i != state.range(0) - 2; ++i) {
+        double x = 100 * static_cast<double>(i) / (n - 1);
+        verts.emplace_back(x, surface(x));
+    }
+    verts.emplace_back(100, 0);
+    verts.emplace_back(0, 0);
+    Polygon poly{verts};
+    if (state.range(1) != 0) poly.buildIndex();
+
+    std::mt19937                           gen{42};
+    std::uniform_real_distribution<double> along{0.0, 100.0};
+    std::uniform_real_distribution<double> depth{0.0, 0.3};
+    std::vector<Vec2>                      pos;
+    for (int i = 0; i != 1024; ++i) {
+        double x = along(gen);
+        pos.emplace_back(x, surface(x) - depth(gen));
+    }
+    std::size_t i = 0;
+    for (auto _: state) {
+        Vec2 p   = pos[i++ % pos.size()];
+        Vec2 vel = {0, -1};
+        benchmark::DoNotOptimize(poly.collide(p, vel));
+        benchmark::DoNotOptimize(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PolygonCollide)->ArgsProduct({{8, 64, 512, 4096, 32768}, {0, 1}});
+
+// second argument selects the grid index over the linear scan
+void BM_FindClosestPoint(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    if (state.range(1) != 0) e.rebuildPointIndex();
+    auto        pos = queries(state.range(0), 1024);
+    std::size_t i   = 0;
+    for (auto _: state) benchmark::DoNotOptimize(e.findClosestPoint(pos[i++ % pos.size()]));
+    setCounters(state, e);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindClosestPoint)->ArgsProduct({{10, 100, 1000}, {0, 1}});
+
+void BM_FindClosestSpring(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    if (state.range(1) != 0) e.rebuildSpringIndex();
+    auto        pos = queries(state.range(0), 1024);
+    std::size_t i   = 0;
+    for (auto _: state) benchmark::DoNotOptimize(e.findClosestSpring(pos[i++ % pos.size()]));
+    setCounters(state, e);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindClosestSpring)->ArgsProduct({{10, 100, 1000}, {0, 1}});
+
+// persistance, throughput is in file bytes
+
+const std::filesystem::path benchFile = std::filesystem::temp_directory_path() / "physenv_bench";
+
+void BM_SaveEng(benchmark::State& state) {
+    Engine      e = grid(state.range(0));
+    SilenceCout quiet;
+    for (auto _: state) persisitance::saveEng(e, benchFile, {true, true, true});
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(std::filesystem::file_size(benchFile)));
+}
+BENCHMARK(BM_SaveEng)->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+void BM_LoadEng(benchmark::State& state) {
+    {
+        SilenceCout quiet;
+        persisitance::saveEng(grid(state.range(0)), benchFile, {true, true, true});
+    }
+    for (auto _: state) {
+        Engine e{};
+        persisitance::loadEng(e, benchFile, true, {true, true, true});
+        benchmark::DoNotOptimize(e.points.size());
+    }
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(std::filesystem::file_size(benchFile)));
+}
+BENCHMARK(BM_LoadEng)->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+void BM_SaveSnapshot(benchmark::State& state) {
+    Engine e = grid(state.range(0));
+    for (auto _: state) persisitance::saveSnapshot(e, benchFile, {true, true, true});
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(std::filesystem::file_size(benchFile)));
+}
+BENCHMARK(BM_SaveSnapshot)->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+void BM_LoadSnapshot(benchmark::State& state) {
+    persisitance::saveSnapshot(grid(state.range(0)), benchFile, {true, true, true});
+    for (auto _: state) {
+        Engine e{};
+        persisitance::loadSnapshot(e, benchFile, true, {true, true, true});
+        benchmark::DoNotOptimize(e.points.size());
+    }
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<std::int64_t>(std::filesystem::file_size(benchFile)));
+}
+BENCHMARK(BM_LoadSnapshot)->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+// containers
+
+template <typename C>
+void BM_ContainerInsert(benchmark::State& state) {
+    for (auto _: state) {
+        C c;
+        for (std::int64_t i = 0; i != state.range(0); ++i) c.insert(spring());
+        benchmark::DoNotOptimize(c.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// erases every element in a shuffled order, one at a time
+template <typename C>
+void BM_ContainerErase(benchmark::State& state) {
+    std::mt19937 gen{42};
+    for (auto _: state) {
+        state.PauseTiming();
+        C                                          c;
+        std::vector<decltype(c.insert(spring()))> refs;
+        for (std::int64_t i = 0; i != state.range(0); ++i) refs.push_back(c.insert(spring()));
+        std::shuffle(refs.begin(), refs.end(), gen);
+        state.ResumeTiming();
+        for (const auto& ref: refs) c.erase(ref);
+        benchmark::DoNotOptimize(c.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// half the elements erased first so the holes and compaction are part of the picture
+template <typename C>
+void BM_ContainerIterate(benchmark::State& state) {
+    C                                          c;
+    std::vector<decltype(c.insert(spring()))> refs;
+    for (std::int64_t i = 0; i != state.range(0); ++i) refs.push_back(c.insert(spring()));
+    for (std::size_t i = 0; i < refs.size(); i += 2) c.erase(refs[i]);
+    for (auto _: state) {
+        double sum = std::accumulate(c.begin(), c.end(), 0.0, [](double total, const auto& s) {
+            return total + s.obj.springConst;
+        });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(c.size()));
+}
+
+#define CONTAINER_BENCHMARKS(C)                                                                    \
+    BENCHMARK_TEMPLATE(BM_ContainerInsert, C)->RangeMultiplier(100)->Range(100, 1000000);          \
+    BENCHMARK_TEMPLATE(BM_ContainerErase, C)->RangeMultiplier(100)->Range(100, 1000000);           \
+    BENCHMARK_TEMPLATE(BM_ContainerIterate, C)->RangeMultiplier(100)->Range(100, 1000000)
+
+CONTAINER_BENCHMARKS(details::PepperedVector<Spring>);
+CONTAINER_BENCHMARKS(details::CompactMap<Spring>);
+CONTAINER_BENCHMARKS(details::SlotMap<Spring>);
@@ -1,143 +1,1049 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <barrier>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "Point.hpp"
+#include "PointStore.hpp"
 #include "Polygon.hpp"
+#include "Profiler.hpp"
 #include "Spring.hpp"
+#include "absl/container/flat_hash_set.h"
+#include "details/Islands.hpp"
+#include "details/SpringKernel.hpp"
+#include "details/ThreadPool.hpp"
+#include "details/UniformGrid.hpp"
 
 namespace physenv {
 
-class Engine {
+enum class Integrator {
+    SemiImplicitEuler, // v += a dt then x += v dt - one force evaluation per frame
+    VelocityVerlet,    // half kick, drift, half kick - two force evaluations per frame
+    RK4,               // classic 4th order runge kutta - four force evaluations per frame
+};
+
+// controls Engine::step
+struct StepSettings {
+    double      fixedDeltaTime = 1.0 / 120; // simulated time per fixed step
+    std::size_t substeps       = 1;         // simFrames per fixed step when not adaptive
+    std::size_t maxSteps       = 8;         // fixed steps per call, extra time is dropped
+    bool        adaptive       = false;     // size substeps from the fastest point instead
+    double      maxMove        = 0.05;      // furthest a point may move in one adaptive substep
+    std::size_t maxSubsteps    = 64;        // cap on adaptive substeps per fixed step
+};
+
+// controls island sleeping, islands are the groups of points connected by springs
+struct SleepSettings {
+    bool        enabled         = false;
+    double      energyThreshold = 5E-3; // mean kinetic energy per point of a resting island
+    std::size_t framesToSleep   = 60;   // consecutive resting frames before an island sleeps
+};
+
+// chunk sizes the parallel phases are split into when Engine::threads > 1, springs are always
+// split into one chunk per thread
+struct GrainSettings {
+    std::size_t points  = 4096; // integration
+    std::size_t collide = 512;  // collision detection and response
+    std::size_t queries = 64;   // positions of a batch query
+};
+
+struct StepResult {
+    std::size_t steps    = 0; // fixed steps taken
+    std::size_t substeps = 0; // simFrames run
+    double      dropped  = 0; // time discarded because maxSteps was hit
+    double      alpha    = 0; // leftover fraction of a fixed step (for render interpolation)
+};
+
+// T is the scalar the points, springs and polygons are simulated in, see Engine and EngineF
+template <typename T>
+class BasicEngine {
   public:
-    double                gravity;
+    using Vec        = details::Vector2<T>;
+    using Point      = BasicPoint<T>;
+    using Spring     = BasicSpring<T>;
+    using Polygon    = BasicPolygon<T>;
+    using PointStore = BasicPointStore<T>;
+    using PointRef   = BasicPointRef<T>;
+    using SpringRef  = BasicSpringRef<T>;
+    using PolyRef    = BasicPolyRef<T>;
+
+    // spring for addBulk, p1 and p2 index the points added alongside it
+    struct LocalSpring {
+        T           springConst;
+        T           dampFact;
+        T           naturalLength;
+        std::size_t p1;
+        std::size_t p2;
+    };
+    // refs of a bulk add, in the order they were given
+    struct BulkRefs {
+        std::vector<PointRef>  points;
+        std::vector<SpringRef> springs;
+    };
+
+    T                     gravity;
     StableVector<Polygon> polys;
-    StableVector<Point>   points;
+    PointStore            points;
     StableVector<Spring>  springs;
+    Integrator            integrator    = Integrator::SemiImplicitEuler;
+    std::size_t           threads       = 1; // 1 is serial, more runs the phases on a pool
+    bool                  indexPoints   = false; // rebuild the point index every simFrame
+    bool                  indexSprings  = false; // rebuild the spring index every simFrame
+    StepSettings          stepping{};
+    SleepSettings         sleeping{};
+    GrainSettings         grains{};
+    // per phase times and counters of each simFrame, empty without PHYSENV_PROFILE
+    // springForces and collide called outside simFrame are counted towards the next frame
+    [[no_unique_address]] Profiler profiler{};
+    // immutable polygons shared between engines (see Ensemble), collided with after polys
+    // copies share them too, they aren't saved or snapshotted
+    std::shared_ptr<const StableVector<Polygon>> sharedPolys{};
+
+  private:
+    // state kept between the force evaluations of the multi stage integrators
+    struct StageBuffers {
+        std::vector<T> extForceX, extForceY;       // forces applied before the frame
+        std::vector<T> posX, posY, velX, velY;     // state at the start of the frame
+        std::vector<T> dPosX, dPosY, dVelX, dVelY; // weighted sum of the rk4 derivatives
+    };
+
+    mutable details::ThreadPool pool{};         // spawned on the first parallel phase
+    details::SpringArrays<T>    springData{};   // springs resolved for the batch kernel
+    StageBuffers                stages{};
+    double                      accumulator = 0; // unsimulated time carried between steps
+    std::vector<std::vector<T>> threadForces{}; // per thread x then y force buffers
+    details::UniformGrid        polyGrid{};     // broad phase over polygon bounds
+    details::UniformGrid        pointGrid{};    // point queries, see indexPoints
+    std::size_t                 pointGridSize  = 0;
+    bool                        pointGridValid = false;
+    details::UniformGrid        springGrid{}; // spring segment queries, see indexSprings
+    std::vector<std::size_t>    springEnds{}; // dense point indicies (p1, p2) per spring
+    bool                        springGridValid = false;
+    absl::flat_hash_map<PointRef, std::vector<SpringRef>, std::hash<PointRef>>
+        pointSprings{}; // springs attached to each point, kept by addSpring and the removers
+    std::vector<PointRef>  pendingPoints{}; // removals deferred to the end of the frame
+    std::vector<SpringRef> pendingSprings{};
+
+    // sleeping islands skip every phase of simFrame, see SleepSettings
+    struct IslandState {
+        details::Islands          islands{};
+        std::vector<std::size_t>  restingFrames{}; // per island
+        std::vector<std::uint8_t> asleep{};        // per island
+        std::vector<double>       energy{};        // per island, scratch for the sleep test
+        std::vector<std::uint8_t> frozen{};        // per point, fixed or asleep
+        std::vector<std::size_t>  awakeSprings{};  // dense indicies of the springs evaluated
+        std::size_t               sleeping   = 0;  // islands asleep
+        std::size_t               springs    = 0;  // spring count islands was built with
+        bool                      valid      = false;
+        bool                      masksValid = false; // frozen and awakeSprings
+        // asleep points carried over a rebuild, an island stays asleep if all its points were
+        absl::flat_hash_set<PointRef, std::hash<PointRef>> sleepers{};
+    };
+    IslandState rest{};
+
+    void unlinkSpring(const PointRef& point, const SpringRef& spring) {
+        auto& attached = pointSprings.at(point);
+        *std::find(attached.begin(), attached.end(), spring) = attached.back();
+        attached.pop_back();
+    }
+
+    // the grids work in double whatever the scalar
+    static Vec2 gridPos(const Vec& v) { return static_cast<Vec2>(v); }
+
+    template <typename F>
+    auto batchQuery(std::span<const Vec> pos, F&& query) const {
+        using Result = decltype(query(pos.front()));
+        if (pos.empty()) return std::vector<Result>{};
+        std::vector<Result> found(pos.size(), query(pos.front())); // refs have no default
+        parallelFor(pos.size(), grains.queries, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) found[i] = query(pos[i]);
+        });
+        return found;
+    }
+
+    // runs body(begin, end) over chunks of [0, count) on up to `threads` threads
+    template <typename F>
+    void parallelFor(std::size_t count, std::size_t grain, F&& body) const {
+        pool.parallelFor(threads, count, grain, std::forward<F>(body));
+    }
+
+    [[nodiscard]] bool pointGridUsable() const {
+        return pointGridValid && pointGridSize == points.size();
+    }
+    [[nodiscard]] bool springGridUsable() const {
+        return springGridValid && springEnds.size() == 2 * springs.size();
+    }
+
+    [[nodiscard]] T springDist(const Vec& pos, std::size_t i) const {
+        return pos.distToLine(points.pos(springEnds[2 * i]), points.pos(springEnds[2 * i + 1]));
+    }
+    [[nodiscard]] SpringRef springRef(std::size_t i) const {
+        return (springs.begin() + static_cast<std::ptrdiff_t>(i))->ind;
+    }
+
+    // refs of points in box for which inside(pos) holds
+    template <typename F>
+    std::vector<PointRef> queryPoints(const details::Aabb& box, F&& inside) const {
+        std::vector<PointRef> found;
+        auto                  check = [&](std::size_t i) {
+            Vec pos = points.pos(i);
+            if (box.contains(gridPos(pos)) && inside(pos)) found.push_back(points.ref(i));
+        };
+        if (pointGridUsable()) {
+            pointGrid.query(box, check); // points only live in one cell so no duplicates
+        } else {
+            for (std::size_t i = 0; i != points.size(); ++i) check(i);
+        }
+        return found;
+    }
+
+    // springs are copied out and resolved, evaluated in blocks by the batch kernel then the forces
+    // are scattered serially (the scatter is what can conflict)
+    void springRange(std::size_t begin, std::size_t end, std::span<T> forceX,
+                     std::span<T> forceY) {
+        const bool filtered = anyAsleep();
+        for (std::size_t s = begin; s != end; ++s) {
+            std::size_t   dense  = filtered ? rest.awakeSprings[s] : s;
+            const Spring& spring = (springs.begin() + static_cast<std::ptrdiff_t>(dense))->obj;
+            springData.p1[s]            = points.index(spring.p1);
+            springData.p2[s]            = points.index(spring.p2);
+            springData.springConst[s]   = spring.springConst;
+            springData.dampFact[s]      = spring.dampFact;
+            springData.naturalLength[s] = spring.naturalLength;
+        }
+
+        const details::PointArrays<T> pts{points.posX().data(), points.posY().data(),
+                                          points.velX().data(), points.velY().data()};
+        constexpr std::size_t    blockSize = 256;
+        std::array<T, blockSize> fx; // filled by the kernel
+        std::array<T, blockSize> fy;
+        for (std::size_t block = begin; block < end; block += blockSize) {
+            std::size_t blockEnd = std::min(end, block + blockSize);
+            details::springForces(pts, springData, block, blockEnd, fx.data(), fy.data());
+            for (std::size_t s = block; s != blockEnd; ++s) {
+                forceX[springData.p1[s]] += fx[s - block]; // equal and opposite reaction
+                forceY[springData.p1[s]] += fy[s - block];
+                forceX[springData.p2[s]] -= fx[s - block];
+                forceY[springData.p2[s]] -= fy[s - block];
+            }
+        }
+    }
+
+    // each chunk of springs accumulates into its own buffer (chunk 0 straight into the points)
+    // and then chunks of points are reduced across the buffers, so no two threads ever write the
+    // same force and the sums don't depend on which thread ran what
+    void parallelSprings(std::size_t chunks) {
+        const std::size_t n     = points.size();
+        const std::size_t count = activeSprings();
+        threadForces.resize(chunks - 1);
+        for (auto& buf: threadForces) buf.resize(2 * n);
+
+        parallelFor(chunks, 1, [&](std::size_t t, std::size_t) {
+            std::size_t sBegin = count * t / chunks;
+            std::size_t sEnd   = count * (t + 1) / chunks;
+            if (t == 0) {
+                springRange(sBegin, sEnd, points.forceX(), points.forceY());
+            } else {
+                auto& buf = threadForces[t - 1];
+                std::fill(buf.begin(), buf.end(), T(0));
+                springRange(sBegin, sEnd, std::span(buf).first(n), std::span(buf).last(n));
+            }
+        });
+
+        auto forceX = points.forceX();
+        auto forceY = points.forceY();
+        parallelFor(n, (n + chunks - 1) / chunks, [&](std::size_t pBegin, std::size_t pEnd) {
+            for (const auto& buf: threadForces) {
+                for (std::size_t i = pBegin; i != pEnd; ++i) {
+                    forceX[i] += buf[i];
+                    forceY[i] += buf[n + i];
+                }
+            }
+        });
+    }
+
+    // every force evaluation starts from the forces applied before the frame
+    void saveExternalForces() {
+        stages.extForceX.assign(points.forceX().begin(), points.forceX().end());
+        stages.extForceY.assign(points.forceY().begin(), points.forceY().end());
+    }
+    void restoreExternalForces() {
+        std::ranges::copy(stages.extForceX, points.forceX().begin());
+        std::ranges::copy(stages.extForceY, points.forceY().begin());
+    }
+
+    void verletStep(T deltaTime) {
+        saveExternalForces();
+        springForces();
+        parallelFor(points.size(), grains.points, [&](std::size_t begin, std::size_t end) {
+            points.kick(deltaTime / 2, gravity, frozen(), begin, end);
+            points.drift(deltaTime, frozen(), begin, end);
+        });
+        restoreExternalForces();
+        springForces(); // at the new positions with the half step velocities
+        parallelFor(points.size(), grains.points, [&](std::size_t begin, std::size_t end) {
+            points.kick(deltaTime / 2, gravity, frozen(), begin, end);
+        });
+        points.clearForces();
+    }
+
+    void rk4Step(T deltaTime) {
+        const std::size_t n = points.size();
+        saveExternalForces();
+        stages.posX.assign(points.posX().begin(), points.posX().end());
+        stages.posY.assign(points.posY().begin(), points.posY().end());
+        stages.velX.assign(points.velX().begin(), points.velX().end());
+        stages.velY.assign(points.velY().begin(), points.velY().end());
+        for (auto* d: {&stages.dPosX, &stages.dPosY, &stages.dVelX, &stages.dVelY}) {
+            d->assign(n, T(0));
+        }
+
+        auto posX    = points.posX();
+        auto posY    = points.posY();
+        auto velX    = points.velX();
+        auto velY    = points.velY();
+        auto fixed   = frozen();
+        auto invMass = points.invMass();
+
+        constexpr std::array<T, 4> weight{1, 2, 2, 1};
+        constexpr std::array<T, 4> nextStep{0.5, 0.5, 1, 0}; // where the next stage samples
+        for (std::size_t stage = 0; stage != 4; ++stage) {
+            if (stage != 0) restoreExternalForces();
+            springForces();
+            auto forceX = points.forceX();
+            auto forceY = points.forceY();
+            parallelFor(n, grains.points, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i != end; ++i) {
+                    if (fixed[i]) continue;
+                    T accX = forceX[i] * invMass[i];
+                    T accY = forceY[i] * invMass[i] - gravity;
+                    stages.dPosX[i] += weight[stage] * velX[i];
+                    stages.dPosY[i] += weight[stage] * velY[i];
+                    stages.dVelX[i] += weight[stage] * accX;
+                    stages.dVelY[i] += weight[stage] * accY;
+                    // derivative of this stage gives the state of the next
+                    T h     = nextStep[stage] * deltaTime;
+                    posX[i] = stages.posX[i] + h * velX[i];
+                    posY[i] = stages.posY[i] + h * velY[i];
+                    velX[i] = stages.velX[i] + h * accX;
+                    velY[i] = stages.velY[i] + h * accY;
+                }
+            });
+        }
 
-    Engine(double gravity_ = 0) : gravity(gravity_) {}
+        parallelFor(n, grains.points, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) {
+                if (fixed[i]) continue;
+                posX[i] = stages.posX[i] + deltaTime / 6 * stages.dPosX[i];
+                posY[i] = stages.posY[i] + deltaTime / 6 * stages.dPosY[i];
+                velX[i] = stages.velX[i] + deltaTime / 6 * stages.dVelX[i];
+                velY[i] = stages.velY[i] + deltaTime / 6 * stages.dVelY[i];
+            }
+        });
+        points.clearForces();
+    }
+
+    [[nodiscard]] bool anyAsleep() const {
+        // a size mismatch means points or springs were changed outside the engine
+        return rest.sleeping != 0 && rest.frozen.size() == points.size() &&
+               rest.springs == springs.size();
+    }
+    [[nodiscard]] std::size_t activeSprings() const {
+        return anyAsleep() ? rest.awakeSprings.size() : springs.size();
+    }
+    // flags the integrators leave alone
+    [[nodiscard]] std::span<const std::uint8_t> frozen() const {
+        return anyAsleep() ? std::span<const std::uint8_t>(rest.frozen) : points.fixed();
+    }
+
+    void resetIslands() {
+        rest.valid    = false;
+        rest.sleeping = 0;
+        rest.sleepers.clear();
+        rest.frozen.clear();
+        rest.awakeSprings.clear();
+    }
+
+    // called before the spring graph changes, the next simFrame rebuilds the islands
+    void editIslands() {
+        if (!rest.valid) return;
+        rest.valid = false;
+        if (anyAsleep()) {
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                if (rest.asleep[rest.islands.of[i]]) rest.sleepers.insert(points.ref(i));
+            }
+        }
+        rest.sleeping = 0;
+    }
+    // the island of an edited point wakes
+    void wakeOnEdit(const PointRef& point) {
+        editIslands();
+        rest.sleepers.erase(point);
+    }
 
-    void simFrame(double deltaTime) {
-        // calculate spring force worth doing in parralel
-        std::for_each(springs.begin(), springs.end(), [&](auto& spring) {
-            spring.obj.springHandler(points[spring.obj.p1], points[spring.obj.p2]);
+    void rebuildIslands() {
+        auto spring = [&](std::size_t s) -> const Spring& {
+            return (springs.begin() + static_cast<std::ptrdiff_t>(s))->obj;
+        };
+        rest.islands.build(points.size(), springs.size(), [&](std::size_t s) {
+            return std::pair{points.index(spring(s).p1), points.index(spring(s).p2)};
         });
+        const std::size_t count = rest.islands.count();
+        rest.restingFrames.assign(count, 0);
+        rest.asleep.assign(count, rest.sleepers.empty() ? 0 : 1);
+        if (!rest.sleepers.empty()) {
+            for (std::size_t i = 0; i != points.size(); ++i) {
+                if (!rest.sleepers.contains(points.ref(i))) rest.asleep[rest.islands.of[i]] = 0;
+            }
+        }
+        rest.sleepers.clear();
+        rest.sleeping = static_cast<std::size_t>(std::ranges::count(rest.asleep, 1));
+        rest.springs  = springs.size();
+        rest.valid    = true;
+        refreshMasks();
+    }
+
+    void refreshMasks() {
+        auto fixed = points.fixed();
+        rest.frozen.resize(points.size());
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            rest.frozen[i] = fixed[i] | rest.asleep[rest.islands.of[i]];
+        }
+        rest.awakeSprings.clear();
+        std::size_t s = 0;
+        for (const auto& spring: springs) {
+            if (!rest.asleep[rest.islands.of[points.index(spring.obj.p1)]]) {
+                rest.awakeSprings.push_back(s);
+            }
+            ++s;
+        }
+    }
+
+    void wakeIsland(std::size_t island) {
+        rest.asleep[island]        = 0;
+        rest.restingFrames[island] = 0;
+        --rest.sleeping;
+    }
+
+    // brings the islands up to date and wakes the sleeping ones pushed by an external force
+    void prepareIslands() {
+        if (!rest.valid || rest.islands.of.size() != points.size() ||
+            rest.springs != springs.size()) {
+            rebuildIslands();
+        }
+        if (!anyAsleep()) return;
+        auto forceX = points.forceX();
+        auto forceY = points.forceY();
+        bool woke   = false;
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            std::size_t island = rest.islands.of[i];
+            if (rest.asleep[island] && (forceX[i] != 0 || forceY[i] != 0)) {
+                wakeIsland(island);
+                woke = true;
+            }
+        }
+        if (woke) refreshMasks();
+    }
+
+    // islands whose mean kinetic energy stays under the threshold for framesToSleep frames fall
+    // asleep from a standstill
+    void sleepRestingIslands() {
+        if (!rest.valid) return;
+        const auto& islands = rest.islands;
+        auto        velX    = points.velX();
+        auto        velY    = points.velY();
+        auto        mass    = points.mass();
+        rest.energy.assign(islands.count(), 0.0);
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            std::size_t island = islands.of[i];
+            if (rest.asleep[island]) continue;
+            rest.energy[island] += 0.5 * mass[i] * (velX[i] * velX[i] + velY[i] * velY[i]);
+        }
+
+        bool fell = false;
+        for (std::size_t k = 0; k != islands.count(); ++k) {
+            if (rest.asleep[k]) continue;
+            double limit = sleeping.energyThreshold * static_cast<double>(islands.sizes[k]);
+            if (rest.energy[k] >= limit) {
+                rest.restingFrames[k] = 0;
+            } else if (++rest.restingFrames[k] >= sleeping.framesToSleep) {
+                rest.asleep[k] = 1;
+                ++rest.sleeping;
+                fell = true;
+            }
+        }
+        if (!fell) return;
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            if (rest.asleep[islands.of[i]]) points.setVel(i, {0, 0});
+        }
+        refreshMasks();
+    }
+
+  public:
+    BasicEngine(T gravity_ = 0) : gravity(gravity_) {}
+
+    // adds the spring forces onto the points force
+    void springForces() {
+        [[maybe_unused]] auto timer = profiler.scope(Phase::Springs);
+        const std::size_t     count = activeSprings();
+        profiler.add({.springs = count});
+        springData.resize(count);
+        std::size_t chunks = std::min(threads, count);
+        if (chunks > 1) {
+            parallelSprings(chunks);
+        } else {
+            springRange(0, count, points.forceX(), points.forceY());
+        }
+    }
+
+    void simFrame(T deltaTime) {
+        [[maybe_unused]] auto frame = profiler.frame();
+        if (sleeping.enabled) {
+            prepareIslands();
+        } else if (rest.valid) {
+            resetIslands();
+        }
 
         // update point positions
-        std::for_each(points.begin(), points.end(),
-                      [d = deltaTime, g = gravity](auto& point) { point.obj.update(d, g); });
+        {
+            [[maybe_unused]] auto timer = profiler.scope(Phase::Integrate);
+            switch (integrator) {
+            case Integrator::SemiImplicitEuler:
+                springForces();
+                parallelFor(points.size(), grains.points, [&](std::size_t begin, std::size_t end) {
+                    points.update(deltaTime, gravity, frozen(), begin, end);
+                });
+                break;
+            case Integrator::VelocityVerlet:
+                verletStep(deltaTime);
+                break;
+            case Integrator::RK4:
+                rk4Step(deltaTime);
+                break;
+            }
+        }
 
         // collide points with polygons
-        for (const auto& poly: polys) {
-            for (auto& point: points) {
-                if (poly.obj.isBounded(point.obj.pos) &&
-                    poly.obj.isContained(
-                        point.obj.pos)) // not sure if bounded check is still faster
-                    poly.obj.colHandler(point.obj);
+        collide();
+
+        if (sleeping.enabled) sleepRestingIslands();
+        applyRemovals();
+        // points have moved so an index that isn't rebuilt here is stale
+        if (indexPoints) {
+            rebuildPointIndex();
+        } else {
+            pointGridValid = false;
+        }
+        if (indexSprings) {
+            rebuildSpringIndex();
+        } else {
+            springGridValid = false;
+        }
+    }
+
+    // advances by frameTime of real time in fixed steps of stepping.fixedDeltaTime, the remainder
+    // is carried over to the next call
+    // throws std::invalid_argument before anything changes if fixedDeltaTime (or maxMove when
+    // adaptive) isn't positive, a bad setting would otherwise leave the accumulator nan for good
+    StepResult step(double frameTime) {
+        if (!(stepping.fixedDeltaTime > 0))
+            throw std::invalid_argument("StepSettings::fixedDeltaTime must be positive");
+        if (stepping.adaptive && !(stepping.maxMove > 0))
+            throw std::invalid_argument("StepSettings::maxMove must be positive");
+        StepResult result;
+        accumulator += frameTime;
+        while (accumulator >= stepping.fixedDeltaTime) {
+            if (result.steps == stepping.maxSteps) { // can't keep up so drop whole steps
+                result.dropped = accumulator - std::fmod(accumulator, stepping.fixedDeltaTime);
+                accumulator -= result.dropped;
+                break;
+            }
+            result.substeps += fixedStep();
+            ++result.steps;
+            accumulator -= stepping.fixedDeltaTime;
+        }
+        result.alpha = accumulator / stepping.fixedDeltaTime;
+        return result;
+    }
+
+    // fastest moving non fixed point
+    [[nodiscard]] T maxSpeed() const {
+        auto velX  = points.velX();
+        auto velY  = points.velY();
+        auto fixed = points.fixed();
+        T    maxSq = 0;
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            if (!fixed[i]) maxSq = std::max(maxSq, velX[i] * velX[i] + velY[i] * velY[i]);
+        }
+        return std::sqrt(maxSq);
+    }
+
+    // total kinetic energy of the non fixed points
+    [[nodiscard]] T kineticEnergy() const {
+        auto mass   = points.mass();
+        auto velX   = points.velX();
+        auto velY   = points.velY();
+        auto fixed  = points.fixed();
+        T    energy = 0;
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            if (!fixed[i]) energy += T(0.5) * mass[i] * (velX[i] * velX[i] + velY[i] * velY[i]);
+        }
+        return energy;
+    }
+
+  private:
+    // one fixed step split into substeps, returns how many were run
+    std::size_t fixedStep() {
+        const double stepTime = stepping.fixedDeltaTime;
+        if (!stepping.adaptive) {
+            std::size_t substeps = std::max(stepping.substeps, std::size_t{1});
+            for (std::size_t i = 0; i != substeps; ++i) {
+                simFrame(static_cast<T>(stepTime / static_cast<double>(substeps)));
             }
+            return substeps;
+        }
+
+        // cfl style: no point may travel further than maxMove in a substep
+        const double minDelta = stepTime / static_cast<double>(std::max(stepping.maxSubsteps,
+                                                                        std::size_t{1}));
+        std::size_t  substeps = 0;
+        double       left     = stepTime;
+        while (left > minDelta * 1e-6) {
+            double speed = maxSpeed();
+            double delta = speed > 0 ? stepping.maxMove / speed : left;
+            delta        = std::min(std::max(delta, minDelta), left);
+            if (left - delta < minDelta * 1e-6) delta = left; // don't leave a sliver
+            simFrame(static_cast<T>(delta));
+            left -= delta;
+            ++substeps;
+        }
+        return substeps;
+    }
+
+  public:
+    // broad phase buckets polygons by their bounds so each point only visits the polygons sharing
+    // its cell, visited in polygon order (polys then sharedPolys) to match a polygon by polygon
+    // sweep exactly
+    void collide() {
+        const std::size_t owned = polys.size();
+        const std::size_t count = owned + (sharedPolys ? sharedPolys->size() : 0);
+        if (count == 0) return;
+        auto polyAt = [&](std::size_t i) -> const Polygon& {
+            if (i < owned) return (polys.begin() + static_cast<std::ptrdiff_t>(i))->obj;
+            return (sharedPolys->begin() + static_cast<std::ptrdiff_t>(i - owned))->obj;
+        };
+        {
+            [[maybe_unused]] auto timer = profiler.scope(Phase::BroadPhase);
+            polyGrid.build(count, [&](std::size_t i) {
+                return details::Aabb{gridPos(polyAt(i).min()), gridPos(polyAt(i).max())};
+            });
         }
+
+        // points are independent of each other so chunks can run in any order
+        [[maybe_unused]] auto      timer    = profiler.scope(Phase::NarrowPhase);
+        const std::size_t          grain    = std::max(grains.collide, std::size_t{1});
+        const bool                 filtered = anyAsleep();
+        std::vector<FrameCounters> counts(Profiler::enabled ? points.size() / grain + 1 : 0);
+        parallelFor(points.size(), grain, [&](std::size_t begin, std::size_t end) {
+            FrameCounters chunk{}; // dead code without PHYSENV_PROFILE
+            for (std::size_t i = begin; i != end; ++i) {
+                if (filtered && rest.asleep[rest.islands.of[i]]) continue;
+                Vec         pos  = points.pos(i);
+                std::size_t next = 0; // polygons before this have already been checked
+                bool        hit  = true;
+                while (hit) { // a collision moves the point so the cell has to be looked up again
+                    hit             = false;
+                    auto candidates = polyGrid.cellItems(gridPos(pos));
+                    for (auto it = std::lower_bound(candidates.begin(), candidates.end(), next);
+                         it != candidates.end(); ++it) {
+                        const Polygon& poly = polyAt(*it);
+                        ++chunk.boundedChecks;
+                        if (!poly.isBounded(pos)) continue;
+                        ++chunk.containmentChecks;
+                        Vec vel = points.vel(i);
+                        if (poly.collide(pos, vel)) {
+                            ++chunk.collisions;
+                            points.setPos(i, pos);
+                            points.setVel(i, vel);
+                            next = *it + 1;
+                            hit  = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if constexpr (Profiler::enabled) counts[begin / grain] = chunk;
+        });
+        for (const FrameCounters& chunk: counts) profiler.add(chunk);
     }
 
-    template <typename T>
-    PointRef addPoint(T&& p) {
-        return points.insert(std::forward<T>(p));
+    template <typename U>
+    PointRef addPoint(U&& p) {
+        pointGridValid = false;
+        editIslands();
+        return points.insert(std::forward<U>(p));
     }
 
-    template <typename T>
-    SpringRef addSpring(T&& s) {
-        return springs.insert(std::forward<T>(s));
+    // springs must be added and removed through the engine to keep springsOf() up to date
+    template <typename U>
+    SpringRef addSpring(U&& s) {
+        springGridValid      = false;
+        SpringRef     ref    = springs.insert(std::forward<U>(s));
+        const Spring& spring = springs[ref];
+        wakeOnEdit(spring.p1);
+        wakeOnEdit(spring.p2);
+        pointSprings[spring.p1].push_back(ref);
+        if (spring.p2 != spring.p1) pointSprings[spring.p2].push_back(ref);
+        return ref;
     }
 
+    // adds a whole scene at once, each container is filled in one pass and the adjacency springsOf
+    // reads is built with every list sized up front
+    // throws std::out_of_range (adding nothing) if a spring indexes past newPoints
+    BulkRefs addBulk(std::span<const Point> newPoints, std::span<const LocalSpring> newSprings) {
+        std::vector<std::size_t> degree(newPoints.size());
+        for (const LocalSpring& s: newSprings) {
+            if (s.p1 >= newPoints.size() || s.p2 >= newPoints.size())
+                throw std::out_of_range("Spring indexes a point outside the bulk add");
+            ++degree[s.p1];
+            if (s.p2 != s.p1) ++degree[s.p2];
+        }
+        pointGridValid  = false;
+        springGridValid = false;
+        editIslands();
+
+        BulkRefs refs{points.insert_range(newPoints), {}};
+        // no inserts after the reserve so the lists stay put
+        std::vector<std::vector<SpringRef>*> attached(newPoints.size());
+        pointSprings.reserve(pointSprings.size() + newPoints.size());
+        for (std::size_t i = 0; i != newPoints.size(); ++i) {
+            if (degree[i] == 0) continue;
+            attached[i] = &pointSprings[refs.points[i]];
+            attached[i]->reserve(degree[i]);
+        }
+
+        refs.springs.reserve(newSprings.size());
+        springs.reserve(springs.size() + newSprings.size());
+        for (const LocalSpring& s: newSprings) {
+            SpringRef ref = springs.insert(Spring{s.springConst, s.dampFact, s.naturalLength,
+                                                  refs.points[s.p1], refs.points[s.p2]});
+            refs.springs.push_back(ref);
+            attached[s.p1]->push_back(ref);
+            if (s.p2 != s.p1) attached[s.p2]->push_back(ref);
+        }
+        return refs;
+    }
+
+    // also removes the springs attached to the point, O(degree)
     void rmvPoint(PointRef pos) {
+        pointGridValid  = false;
+        springGridValid = false;
+        editIslands();
         points.erase(pos);
+        rest.sleepers.erase(pos);
 
-        // can be replace with ranges algo
-        std::vector<SpringRef> remIds;
-        for (const auto& spring: springs) {
-            if (spring.obj.p1 == pos || spring.obj.p2 == pos) { // delete
-                remIds.push_back(spring.ind);
+        auto node = pointSprings.extract(pos);
+        if (node.empty()) return;
+        for (const SpringRef& ref: node.mapped()) {
+            const Spring& spring = springs[ref];
+            PointRef      other  = spring.p1 == pos ? spring.p2 : spring.p1;
+            if (other != pos) unlinkSpring(other, ref);
+            wakeOnEdit(other);
+        }
+        springs.erase(node.mapped());
+    }
+
+    void rmvSpring(SpringRef pos) {
+        springGridValid      = false;
+        const Spring& spring = springs[pos];
+        wakeOnEdit(spring.p1);
+        wakeOnEdit(spring.p2);
+        unlinkSpring(spring.p1, pos);
+        if (spring.p2 != spring.p1) unlinkSpring(spring.p2, pos);
+        springs.erase(pos);
+    }
+
+    // bulk versions compact each container once, refs must be unique
+    template <std::ranges::forward_range R>
+        requires std::is_same_v<std::ranges::range_value_t<R>, PointRef>
+    void rmvPoints(R&& range) {
+        pointGridValid  = false;
+        springGridValid = false;
+        editIslands();
+        std::vector<SpringRef> attached;
+        for (const PointRef& pos: range) {
+            rest.sleepers.erase(pos);
+            auto node = pointSprings.extract(pos);
+            if (node.empty()) continue;
+            for (const SpringRef& ref: node.mapped()) {
+                const Spring& spring = springs[ref];
+                PointRef      other  = spring.p1 == pos ? spring.p2 : spring.p1;
+                if (other != pos) unlinkSpring(other, ref); // so it isn't collected twice
+                wakeOnEdit(other);
+                attached.push_back(ref);
             }
         }
-        springs.erase(remIds);
+        springs.erase(attached);
+        points.erase(range);
+    }
+
+    template <std::ranges::forward_range R>
+        requires std::is_same_v<std::ranges::range_value_t<R>, SpringRef>
+    void rmvSprings(R&& range) {
+        springGridValid = false;
+        for (const SpringRef& pos: range) {
+            const Spring& spring = springs[pos];
+            wakeOnEdit(spring.p1);
+            wakeOnEdit(spring.p2);
+            unlinkSpring(spring.p1, pos);
+            if (spring.p2 != spring.p1) unlinkSpring(spring.p2, pos);
+        }
+        springs.erase(range);
+    }
+
+    // queued and removed together by applyRemovals at the end of the next simFrame, so mass edits
+    // made during a frame cost one compaction, queuing the same ref twice is fine
+    void rmvPointDeferred(PointRef pos) { pendingPoints.push_back(pos); }
+    void rmvSpringDeferred(SpringRef pos) { pendingSprings.push_back(pos); }
+
+    void applyRemovals() {
+        if (pendingPoints.empty() && pendingSprings.empty()) return;
+        // stale refs and repeats are dropped, refs have no public ordering so sets find repeats
+        absl::flat_hash_set<PointRef, std::hash<PointRef>> doomedPoints;
+        std::erase_if(pendingPoints, [&](const PointRef& ref) {
+            return !points.contains(ref) || !doomedPoints.insert(ref).second;
+        });
+        absl::flat_hash_set<SpringRef, std::hash<SpringRef>> doomedSprings;
+        std::erase_if(pendingSprings, [&](const SpringRef& ref) {
+            if (!springs.contains(ref) || !doomedSprings.insert(ref).second) return true;
+            // springs attached to removed points go with them
+            return doomedPoints.contains(springs[ref].p1) || doomedPoints.contains(springs[ref].p2);
+        });
+        rmvSprings(pendingSprings);
+        rmvPoints(pendingPoints);
+        pendingPoints.clear();
+        pendingSprings.clear();
+    }
+
+    // islands fall asleep once resting (see SleepSettings) and skip every phase of simFrame, they
+    // wake when a force is applied to one of their points or their springs are edited
+    // points moved directly through `points` don't wake their island, call wake for that
+    [[nodiscard]] bool isAsleep(const PointRef& point) const {
+        if (!rest.valid) return rest.sleepers.contains(point);
+        std::size_t i = points.index(point);
+        return i < rest.islands.of.size() && rest.asleep[rest.islands.of[i]];
+    }
+    void wake(const PointRef& point) {
+        if (!rest.valid) {
+            rest.sleepers.erase(point);
+            return;
+        }
+        std::size_t i = points.index(point);
+        if (i < rest.islands.of.size() && rest.asleep[rest.islands.of[i]]) {
+            wakeIsland(rest.islands.of[i]);
+            refreshMasks();
+        }
+    }
+    void wakeAll() { resetIslands(); }
+    [[nodiscard]] std::size_t sleepingIslands() const { return rest.sleeping; }
+
+    // springs attached to a point, invalidated by adding or removing springs
+    [[nodiscard]] std::span<const SpringRef> springsOf(const PointRef& point) const {
+        auto it = pointSprings.find(point);
+        if (it == pointSprings.end()) return {};
+        return it->second;
+    }
+
+    void clear() {
+        points.clear();
+        springs.clear();
+        polys.clear();
+        sharedPolys.reset();
+        pointSprings.clear();
+        pendingPoints.clear();
+        pendingSprings.clear();
+        pointGridValid  = false;
+        springGridValid = false;
+        resetIslands();
     }
 
-    void rmvSpring(SpringRef pos) { springs.erase(pos); }
+    // rebuilds the point index (done by simFrame when indexPoints is set)
+    // points moved directly through `points` are only seen by the index after this
+    void rebuildPointIndex() {
+        pointGrid.build(points.size(), [&](std::size_t i) {
+            Vec2 pos = gridPos(points.pos(i));
+            return details::Aabb{pos, pos};
+        });
+        pointGridSize  = points.size();
+        pointGridValid = true;
+    }
 
-    std::pair<PointRef, double> findClosestPoint(const Vec2 pos) const { //
+    // the queries use the point index when it is up to date and fall back to a linear scan
+    std::pair<PointRef, T> findClosestPoint(const Vec pos) const { //
         if (points.empty()) throw std::logic_error("Finding closest point with no points?!? ;)");
-        double   closestDist = std::numeric_limits<double>::infinity();
-        PointRef closestPos  = points.cbegin()->ind;
-        for (auto p: points) {
-            Vec2   diff = pos - p.obj.pos;
-            double dist = diff.x * diff.x + diff.y * diff.y;
-            if (dist < closestDist) {
-                closestDist = dist;
-                closestPos  = p.ind;
+        auto posX = points.posX();
+        auto posY = points.posY();
+        auto dist = [&](std::size_t i) {
+            T dx = pos.x - posX[i];
+            T dy = pos.y - posY[i];
+            return dx * dx + dy * dy;
+        };
+        if (pointGridUsable()) {
+            auto [closestPos, closestDist] = pointGrid.nearest(
+                gridPos(pos), [&](std::size_t i) { return double(std::sqrt(dist(i))); });
+            return std::pair<PointRef, T>(points.ref(closestPos), T(closestDist));
+        }
+
+        T           closestDist = std::numeric_limits<T>::infinity();
+        std::size_t closestPos  = 0;
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            if (dist(i) < closestDist) {
+                closestDist = dist(i);
+                closestPos  = i;
             }
         }
-        return std::pair<PointRef, double>(closestPos, std::sqrt(closestDist));
+        return std::pair<PointRef, T>(points.ref(closestPos), std::sqrt(closestDist));
     }
 
-    std::pair<SpringRef, double> findClosestSpring(const Vec2 pos) const {
+    std::vector<PointRef> findPointsInBox(const Vec& min, const Vec& max) const {
+        return queryPoints({gridPos(min), gridPos(max)}, [](const Vec&) { return true; });
+    }
+
+    std::vector<PointRef> findPointsInRadius(const Vec& pos, T radius) const {
+        Vec extent{radius, radius};
+        return queryPoints({gridPos(pos - extent), gridPos(pos + extent)}, [&](const Vec& p) {
+            Vec diff = p - pos;
+            return diff.dot(diff) <= radius * radius;
+        });
+    }
+
+    // rebuilds the spring segment index (done by simFrame when indexSprings is set)
+    // points moved directly through `points` are only seen by the index after this
+    void rebuildSpringIndex() {
+        springEnds.clear();
+        springEnds.reserve(2 * springs.size());
+        for (const auto& spring: springs) {
+            springEnds.push_back(points.index(spring.obj.p1));
+            springEnds.push_back(points.index(spring.obj.p2));
+        }
+        springGrid.build(springs.size(), [&](std::size_t i) {
+            Vec2 p1 = gridPos(points.pos(springEnds[2 * i]));
+            Vec2 p2 = gridPos(points.pos(springEnds[2 * i + 1]));
+            return details::Aabb{{std::min(p1.x, p2.x), std::min(p1.y, p2.y)},
+                                 {std::max(p1.x, p2.x), std::max(p1.y, p2.y)}};
+        });
+        springGridValid = true;
+    }
+
+    std::pair<SpringRef, T> findClosestSpring(const Vec pos) const {
         if (springs.empty()) throw std::logic_error("Finding closest spring with no springs?!? ;)");
-        double    closestDist = std::numeric_limits<double>::infinity();
+        if (springGridUsable()) {
+            auto [closestPos, closestDist] = springGrid.nearest(
+                gridPos(pos), [&](std::size_t i) { return double(springDist(pos, i)); });
+            return std::pair<SpringRef, T>(springRef(closestPos), T(closestDist));
+        }
+
+        T         closestDist = std::numeric_limits<T>::infinity();
         SpringRef closestPos  = springs.cbegin()->ind;
         for (auto spring: springs) {
-            double dist = pos.distToLine(points[spring.obj.p1].pos, points[spring.obj.p2].pos);
+            T dist = pos.distToLine(points.pos(spring.obj.p1), points.pos(spring.obj.p2));
             if (dist < closestDist) {
                 closestDist = dist;
                 closestPos  = spring.ind;
             }
         }
-        return std::pair<SpringRef, double>(closestPos, std::sqrt(closestDist));
+        return std::pair<SpringRef, T>(closestPos, closestDist);
+    }
+
+    // batch versions of the closest queries, positions are split over the threads in chunks of
+    // grains.queries
+    std::vector<std::pair<PointRef, T>> findClosestPoints(std::span<const Vec> pos) const {
+        return batchQuery(pos, [&](const Vec& p) { return findClosestPoint(p); });
+    }
+    std::vector<std::pair<SpringRef, T>> findClosestSprings(std::span<const Vec> pos) const {
+        return batchQuery(pos, [&](const Vec& p) { return findClosestSpring(p); });
+    }
+
+    std::vector<SpringRef> findSpringsInRadius(const Vec& pos, T radius) const {
+        std::vector<SpringRef> found;
+        if (springGridUsable()) {
+            std::vector<std::size_t> candidates; // springs spanning cells turn up more than once
+            Vec                      extent{radius, radius};
+            springGrid.query({gridPos(pos - extent), gridPos(pos + extent)},
+                             [&](std::size_t i) { candidates.push_back(i); });
+            std::ranges::sort(candidates);
+            auto [first, last] = std::ranges::unique(candidates);
+            candidates.erase(first, last);
+            for (std::size_t i: candidates) {
+                if (springDist(pos, i) <= radius) found.push_back(springRef(i));
+            }
+        } else {
+            for (const auto& spring: springs) {
+                if (pos.distToLine(points.pos(spring.obj.p1), points.pos(spring.obj.p2)) <= radius)
+                    found.push_back(spring.ind);
+            }
+        }
+        return found;
     }
 
     // void reset() { load(Previous, true, {true, true, true}, false); }
 
-    static Engine softbody(const details::Vector2<std::size_t>& size, const Vec2& simPos,
-                           float gravity, float gap, float springConst, float dampFact) {
-        Engine sim{gravity};
+    // size.x by size.y grid of points gap apart from simPos, each joined to its neighbours across
+    // and diagonally
+    static BasicEngine softbody(const details::Vector2<std::size_t>& size, const Vec& simPos,
+                                float gravity, float gap, float springConst, float dampFact) {
+        BasicEngine sim{gravity};
 
         sim.polys.reserve(2);
-        sim.polys.insert(Polygon::Square(Vec2(1, 0), -0.75));
-        sim.polys.insert(Polygon::Square(Vec2(9, 0), 0.75));
+        sim.polys.insert(Polygon::Square(Vec(1, 0), T(-0.75)));
+        sim.polys.insert(Polygon::Square(Vec(9, 0), T(0.75)));
+        if (size.x == 0 || size.y == 0) return sim;
 
-        sim.points.reserve(size.x * size.y);
-        std::vector<PointRef> tempPointRefs;
-        for (unsigned x = 0; x != size.x; ++x) {
-            for (unsigned y = 0; y != size.y; ++y) {
-                tempPointRefs.push_back(sim.addPoint(Point{Vec2(x, y) * gap + simPos, 1.0}));
+        std::vector<Point> grid;
+        grid.reserve(size.x * size.y);
+        for (std::size_t x = 0; x != size.x; ++x) {
+            for (std::size_t y = 0; y != size.y; ++y) {
+                grid.push_back(Point{Vec(T(x), T(y)) * T(gap) + simPos, 1});
             }
         }
 
+        const T across   = static_cast<T>(gap);
+        const T diagonal = std::numbers::sqrt2_v<T> * static_cast<T>(gap);
+        auto    at       = [&](std::size_t x, std::size_t y) { return x * size.y + y; };
+
+        std::vector<LocalSpring> lattice;
+        lattice.reserve(2 * (size.x - 1) * (size.y - 1) + (size.x - 1) * size.y +
+                        size.x * (size.y - 1));
         for (std::size_t x = 0; x != size.x; ++x) {
             for (std::size_t y = 0; y != size.y; ++y) {
-                PointRef p = tempPointRefs[x + y * size.x];
+                std::size_t p = at(x, y);
                 if (x < size.x - 1) {
-                    if (y < size.y - 1) {
-                        sim.addSpring(Spring{
-                            springConst, dampFact, std::numbers::sqrt2 * static_cast<double>(gap),
-                            p, tempPointRefs[x + 1 + (y + 1) * size.x]}); // down right
+                    if (y < size.y - 1) { // down right
+                        lattice.push_back({springConst, dampFact, diagonal, p, at(x + 1, y + 1)});
                     }
-                    sim.addSpring(Spring{springConst, dampFact, gap, p,
-                                         tempPointRefs[x + 1 + (y)*size.x]}); // right
+                    lattice.push_back({springConst, dampFact, across, p, at(x + 1, y)}); // right
                 }
                 if (y < size.y - 1) {
-                    if (x > 0) {
-                        sim.addSpring(Spring{springConst, dampFact,
-                                             std::numbers::sqrt2 * static_cast<double>(gap), p,
-                                             tempPointRefs[x - 1 + (y + 1) * size.x]}); // down left
+                    if (x > 0) { // down left
+                        lattice.push_back({springConst, dampFact, diagonal, p, at(x - 1, y + 1)});
                     }
-                    sim.addSpring(Spring{springConst, dampFact, gap, p,
-                                         tempPointRefs[x + (y + 1) * size.x]}); // down
+                    lattice.push_back({springConst, dampFact, across, p, at(x, y + 1)}); // down
                 }
             }
         }
+        sim.addBulk(grid, lattice);
         return sim;
     }
 };
 
+using Engine  = BasicEngine<double>;
+using EngineF = BasicEngine<float>;
+
 } // namespace physenv
 
 // using PointRef = physenv::PointRef;
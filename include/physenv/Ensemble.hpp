@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "Engine.hpp"
+#include "details/ThreadPool.hpp"
+
+namespace physenv {
+
+// how one member of an ensemble differs from the prototype
+template <typename T>
+struct BasicMemberParams {
+    std::optional<T> gravity{};      // the prototype's when unset
+    T                springScale = 1; // multiplies the springConst of every spring
+    T                dampScale   = 1; // multiplies the dampFact of every spring
+};
+
+// spread of a metric over the members of an ensemble
+struct EnsembleStats {
+    double      mean   = 0;
+    double      stddev = 0; // population
+    double      min    = 0;
+    double      max    = 0;
+    std::size_t argMin = 0; // member with the smallest value
+    std::size_t argMax = 0;
+};
+
+// many engines stepped side by side, e.g. a sweep over spring constants, damping and gravity
+// members start as copies of a prototype with its polygons moved into one immutable set they all
+// collide with through Engine::sharedPolys, so detailed outlines and their indexes exist once
+// members are dealt out whole to the pool's threads and each runs serially within (its threads
+// is set to 1), independent members scale better than splitting every member's phases
+template <typename T>
+class BasicEnsemble {
+  public:
+    using Engine  = BasicEngine<T>;
+    using Params  = BasicMemberParams<T>;
+    using Polygon = BasicPolygon<T>;
+
+    std::size_t threads = 1; // 1 steps the members one after another
+
+  private:
+    std::vector<Engine>                          members_{};
+    std::shared_ptr<const StableVector<Polygon>> geometry_{};
+    mutable details::ThreadPool                  pool{};
+
+    // fn(i) for every member index over the pool, one member per chunk as they're coarse
+    template <typename F>
+    void forEach(F&& fn) const {
+        pool.parallelFor(threads, members_.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i != end; ++i) fn(i);
+        });
+    }
+
+  public:
+    BasicEnsemble(Engine prototype, std::span<const Params> params) {
+        if (!prototype.polys.empty()) { // the prototype's own polygons go first as in collide
+            auto geometry = std::make_shared<StableVector<Polygon>>(std::move(prototype.polys));
+            if (prototype.sharedPolys) {
+                for (const auto& poly: *prototype.sharedPolys) geometry->insert(poly.obj);
+            }
+            prototype.polys.clear();
+            prototype.sharedPolys = std::move(geometry);
+        }
+        prototype.threads = 1;
+        geometry_         = prototype.sharedPolys;
+
+        members_.reserve(params.size());
+        for (const Params& p: params) {
+            Engine& member = members_.emplace_back(prototype);
+            if (p.gravity) member.gravity = *p.gravity;
+            for (auto& spring: member.springs) {
+                spring.obj.springConst *= p.springScale;
+                spring.obj.dampFact *= p.dampScale;
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t   size() const { return members_.size(); }
+    [[nodiscard]] Engine&       operator[](std::size_t i) { return members_[i]; }
+    [[nodiscard]] const Engine& operator[](std::size_t i) const { return members_[i]; }
+    [[nodiscard]] auto          begin() { return members_.begin(); }
+    [[nodiscard]] auto          end() { return members_.end(); }
+    [[nodiscard]] auto          begin() const { return members_.begin(); }
+    [[nodiscard]] auto          end() const { return members_.end(); }
+
+    // the polygons every member collides with, null if the prototype had none
+    [[nodiscard]] const std::shared_ptr<const StableVector<Polygon>>& geometry() const {
+        return geometry_;
+    }
+
+    void simFrame(T deltaTime) {
+        forEach([&](std::size_t i) { members_[i].simFrame(deltaTime); });
+    }
+
+    // Engine::step on every member, results in member order
+    std::vector<StepResult> step(double frameTime) {
+        std::vector<StepResult> results(members_.size());
+        forEach([&](std::size_t i) { results[i] = members_[i].step(frameTime); });
+        return results;
+    }
+
+    // fn(member) for every member over the pool, results in member order
+    template <typename F>
+    auto collect(F&& fn) const {
+        using R = std::remove_cvref_t<std::invoke_result_t<F&, const Engine&>>;
+        static_assert(!std::is_same_v<R, bool>, "std::vector<bool> can't be filled in parallel");
+        std::vector<R> results(members_.size());
+        forEach([&](std::size_t i) { results[i] = fn(members_[i]); });
+        return results;
+    }
+
+    // metric(member) for every member summarised, e.g. stats(&Engine::kineticEnergy)
+    template <typename F>
+    EnsembleStats stats(F&& metric) const {
+        EnsembleStats result;
+        if (members_.empty()) return result;
+        std::vector<double> values = collect([&](const Engine& member) {
+            return static_cast<double>(std::invoke(metric, member));
+        });
+        auto [lo, hi] = std::ranges::minmax_element(values);
+        result.min    = *lo;
+        result.max    = *hi;
+        result.argMin = static_cast<std::size_t>(lo - values.begin());
+        result.argMax = static_cast<std::size_t>(hi - values.begin());
+
+        const auto n   = static_cast<double>(values.size());
+        double     sum = 0;
+        for (double v: values) sum += v;
+        result.mean  = sum / n;
+        double sqDev = 0;
+        for (double v: values) sqDev += (v - result.mean) * (v - result.mean);
+        result.stddev = std::sqrt(sqDev / n);
+        return result;
+    }
+};
+
+using MemberParams  = BasicMemberParams<double>;
+using MemberParamsF = BasicMemberParams<float>;
+using Ensemble      = BasicEnsemble<double>;
+using EnsembleF     = BasicEnsemble<float>;
+
+} // namespace physenv
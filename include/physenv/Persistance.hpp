@@ -1,9 +1,12 @@
 #pragma once
 
+#include <charconv>
 #include <filesystem>
 #include <fstream>
+#include <string_view>
 
 #include "Engine.hpp"
+#include "details/MappedFile.hpp"
 
 namespace persisitance {
 template <typename T>
@@ -66,82 +69,162 @@ inline void safeStreamRead(std::istream& is, T& value) {
     is >> value;
 }
 
-// TODO will have to be moved outside as graphs will need to access temp references
+namespace text {
+
+// hands out the lines of a buffer without copying, a trailing '\r' is dropped
+class LineReader {
+  private:
+    std::string_view rest;
+
+  public:
+    explicit LineReader(std::string_view text) : rest(text) {}
+
+    [[nodiscard]] bool done() const { return rest.empty(); }
+
+    std::string_view next() {
+        std::size_t      end  = rest.find('\n');
+        std::string_view line = rest.substr(0, end);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return line;
+    }
+
+    // lines up to (not including) the header line, which is consumed
+    std::pair<std::string_view, std::size_t> section(std::string_view header) {
+        const char* begin = rest.data();
+        std::size_t count = 0;
+        while (!done()) {
+            const char*      lineBegin = rest.data();
+            std::string_view line      = next();
+            if (line == header) {
+                return {{begin, static_cast<std::size_t>(lineBegin - begin)}, count};
+            }
+            ++count;
+        }
+        throw std::runtime_error("Missing headers: \n should be - " + std::string(header));
+    }
+};
+
+// whitespace separated columns of a line read with from_chars
+class Columns {
+  private:
+    std::string_view line;
+    std::size_t      pos = 0;
+
+    void skipSpace() {
+        while (pos != line.size() && (line[pos] == ' ' || line[pos] == '\t')) ++pos;
+    }
+
+  public:
+    explicit Columns(std::string_view line_) : line(line_) {}
+
+    [[nodiscard]] bool empty() {
+        skipSpace();
+        return pos == line.size();
+    }
+
+    template <typename T>
+    T read() {
+        if (empty()) throw std::runtime_error("Not enough columns - read failed");
+        T value{};
+        auto [end, ec] = std::from_chars(line.data() + pos, line.data() + line.size(), value);
+        if (ec != std::errc{})
+            throw std::runtime_error("Invalid column - file invalid: " + std::string(line));
+        pos = static_cast<std::size_t>(end - line.data());
+        return value;
+    }
+};
+
+} // namespace text
+
+// parses the whole file in place, points are gathered into columns and bulk inserted so file
+// indicies map straight onto dense indicies
 inline void loadEng(physenv::Engine& eng, std::filesystem::path path, bool replace,
                     ObjectEnabled enabled) {
     path.make_preferred();
     if (replace) {
-        eng.points.clear();
-        eng.springs.clear();
-        eng.polys.clear();
+        eng.clear();
     }
-    //  pointOffset = static_cast<PointId>(points.size());
 
-    std::ifstream file{path, std::ios_base::in};
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file \"" + path.string() + '"');
-    }
+    physenv::details::MappedFile map{path};
+    text::LineReader             lines{{reinterpret_cast<const char*>(map.bytes().data()),
+                                        map.bytes().size()}};
+    std::string_view             header = lines.next();
+    if (header != PointHeaders)
+        throw std::runtime_error("Point headers invalid: \n is - " + std::string(header) +
+                                 "\n should be - " + PointHeaders);
+    auto [pointText, pointCount]   = lines.section(SpringHeaders);
+    auto [springText, springCount] = lines.section(PolyHeaders);
+
+    std::size_t firstPoint  = eng.points.size();
+    std::size_t pointsAdded = 0;
+    if (enabled.points) {
+        std::vector<double>       posX;
+        std::vector<double>       posY;
+        std::vector<double>       velX;
+        std::vector<double>       velY;
+        std::vector<double>       mass;
+        std::vector<std::uint8_t> fixed;
+        for (auto* col: {&posX, &posY, &velX, &velY, &mass}) col->reserve(pointCount);
+        fixed.reserve(pointCount);
 
-    std::string line;
-    // points
-    std::getline(file, line);
-    if (line != PointHeaders)
-        throw std::runtime_error("Point headers invalid: \n is - " + line + "\n should be - " +
-                                 PointHeaders);
-
-    std::unordered_map<std::size_t, physenv::PointRef> tempPointIds{};
-    std::stringstream                                  ss;
-    std::size_t                                        index = 0;
-    while (true) {
-        std::getline(file, line);
-        if (SpringHeaders == line) break;
-        if (enabled.points) {
-            ss = std::stringstream(line);
-            std::size_t temp;
-            safeStreamRead(ss, temp);
-            if (temp != index) throw std::runtime_error("Non continous point indicie - " + line);
-            // read point
-            tempPointIds.insert(std::make_pair(temp, eng.addPoint(physenv::Point{})));
-            safeStreamRead(ss, eng.points[tempPointIds.at(temp)]);
-            ++index;
+        text::LineReader pointLines{pointText};
+        for (std::size_t index = 0; index != pointCount; ++index) {
+            std::string_view line = pointLines.next();
+            text::Columns    cols{line};
+            if (cols.read<std::size_t>() != index)
+                throw std::runtime_error("Non continous point indicie - " + std::string(line));
+            fixed.push_back(cols.read<std::uint8_t>() != 0);
+            posX.push_back(cols.read<double>());
+            posY.push_back(cols.read<double>());
+            velX.push_back(cols.read<double>());
+            velY.push_back(cols.read<double>());
+            mass.push_back(cols.read<double>());
+            if (!cols.empty())
+                throw std::runtime_error("To many columns for a point - file invalid");
         }
+        firstPoint  = eng.points.insert(posX, posY, velX, velY, mass, fixed);
+        pointsAdded = pointCount;
     }
 
-    index = 0;
-    while (true) {
-        std::getline(file, line);
-        if (PolyHeaders == line) break;
-        if (enabled.springs) {
-            ss = std::stringstream(line);
-            std::size_t temp;
-            safeStreamRead(ss, temp);
-            if (temp != index) throw std::runtime_error("Non continous spring indicie - " + line);
-            // read spring
-            double      springConst;
-            double      dampFact;
-            double      naturalLength;
-            std::size_t tempIdP1;
-            std::size_t tempIdP2;
-            safeStreamRead(ss, springConst);
-            safeStreamRead(ss, dampFact);
-            safeStreamRead(ss, naturalLength);
-            safeStreamRead(ss, tempIdP1);
-            safeStreamRead(ss, tempIdP2);
+    if (enabled.springs) {
+        eng.springs.reserve(eng.springs.size() + springCount);
+        text::LineReader springLines{springText};
+        for (std::size_t index = 0; index != springCount; ++index) {
+            std::string_view line = springLines.next();
+            text::Columns    cols{line};
+            if (cols.read<std::size_t>() != index)
+                throw std::runtime_error("Non continous spring indicie - " + std::string(line));
+            // same order as saveEng and SpringHeaders
+            double      springConst   = cols.read<double>();
+            double      naturalLength = cols.read<double>();
+            double      dampFact      = cols.read<double>();
+            std::size_t tempIdP1      = cols.read<std::size_t>();
+            std::size_t tempIdP2      = cols.read<std::size_t>();
+            if (tempIdP1 >= pointsAdded || tempIdP2 >= pointsAdded)
+                throw std::runtime_error("Spring references a point that doesn't exist - " +
+                                         std::string(line));
             eng.addSpring(physenv::Spring{springConst, dampFact, naturalLength,
-                                          tempPointIds.at(tempIdP1), tempPointIds.at(tempIdP2)});
-            ++index;
+                                          eng.points.ref(firstPoint + tempIdP1),
+                                          eng.points.ref(firstPoint + tempIdP2)});
         }
     }
 
-    while (!file.eof()) {
-        std::getline(file, line);
-        if (enabled.polygons) {
-            ss = std::stringstream(line);
-            if (ss.good()) { // deal with emtpy new lines at end
-                physenv::Polygon poly{};
-                safeStreamRead(ss, poly);
-                eng.polys.insert(poly);
+    if (enabled.polygons) {
+        std::vector<physenv::Vec2> verts;
+        while (!lines.done()) {
+            text::Columns cols{lines.next()};
+            if (cols.empty()) continue; // deal with emtpy new lines at end
+            verts.clear();
+            while (!cols.empty()) {
+                double x = cols.read<double>();
+                verts.emplace_back(x, cols.read<double>());
             }
+            if (verts.size() < 3) throw std::runtime_error("Not enough columns - read failed");
+            physenv::Polygon poly{verts};
+            if (poly.isConvex() == false)
+                throw std::runtime_error("Polygon vertices do not form a convex polygon");
+            eng.polys.insert(std::move(poly));
         }
     }
 }
@@ -178,7 +261,7 @@ inline void saveEng(const physenv::Engine& eng, std::filesystem::path path, Obje
     file << PolyHeaders;
     if (enabled.polygons) {
         for (const auto& p: eng.polys) {
-            if (!p.obj.edges.empty()) file << "\n" << p.obj;
+            if (!p.obj.edges().empty()) file << "\n" << p.obj;
         }
     }
 }
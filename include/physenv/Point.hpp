@@ -5,34 +5,43 @@
 
 namespace physenv {
 
-struct Point {
+template <typename T>
+struct BasicPoint {
   public:
-    Vec2   pos{};
-    Vec2   vel{};
-    Vec2   force{};
-    double mass  = 1.0F;
-    bool   fixed = false;
+    using Vec = details::Vector2<T>;
 
-    Point() = default;
+    Vec  pos{};
+    Vec  vel{};
+    Vec  force{};
+    T    mass  = 1.0F;
+    bool fixed = false;
 
-    Point(const Vec2& pos_, double mass_, const Vec2& vel_ = Vec2(), bool fixed_ = false)
+    BasicPoint() = default;
+
+    BasicPoint(const Vec& pos_, T mass_, const Vec& vel_ = Vec(), bool fixed_ = false)
         : pos(pos_), vel(vel_), mass(mass_), fixed(fixed_) {}
 
-    void update(double deltaTime, double gravity) {
+    void update(T deltaTime, T gravity) {
         if (!fixed) {
-            vel += (force / mass + Vec2(0, -gravity)) * deltaTime; // TODO euler integration could be
-                                                               // improved (e.g. runge kutta)
+            // times 1 / mass like the point store's invMass so the two round the same
+            vel += (force * (T(1) / mass) + Vec(0, -gravity)) * deltaTime;
             pos += vel * deltaTime;
         }
-        force = Vec2();
+        force = Vec();
     }
 
-    bool                 operator==(const Point& obj) const = default;
-    friend std::ostream& operator<<(std::ostream& os, const Point& p) {
+    bool                 operator==(const BasicPoint& obj) const = default;
+    friend std::ostream& operator<<(std::ostream& os, const BasicPoint& p) {
         return os << p.fixed << ' ' << p.pos << ' ' << p.vel << ' ' << p.mass;
     }
 };
 
-using PointRef = details::Ref<Point>;
+using Point  = BasicPoint<double>;
+using PointF = BasicPoint<float>;
+
+template <typename T>
+using BasicPointRef = details::Ref<BasicPoint<T>>;
+using PointRef      = BasicPointRef<double>;
+using PointRefF     = BasicPointRef<float>;
 
-} // namespace physenv
\ No newline at end of file
+} // namespace physenv
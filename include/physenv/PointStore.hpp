@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "Point.hpp"
+#include "details/PointKernel.hpp"
+
+namespace physenv {
+
+// structure of arrays storage for points
+// keeps the CompactMap semantics (stable refs, erase swaps with the back) but every field lives in
+// its own contiguous array so the per frame passes only pull the fields they use through cache
+template <typename T>
+class BasicPointStore {
+  public:
+    using Vec      = details::Vector2<T>;
+    using Point    = BasicPoint<T>;
+    using PointRef = BasicPointRef<T>;
+
+    struct Elem {
+        PointRef ind;
+        Point    obj;
+    };
+
+  private:
+    std::vector<T>            posX_{};
+    std::vector<T>            posY_{};
+    std::vector<T>            velX_{};
+    std::vector<T>            velY_{};
+    std::vector<T>            forceX_{};
+    std::vector<T>            forceY_{};
+    std::vector<T>            invMass_{};
+    std::vector<T>            mass_{}; // kept so saving round trips exactly
+    std::vector<std::uint8_t> fixed_{};
+    std::vector<PointRef>     refs_{};  // dense index -> ref
+    details::SlotTable        slots_{}; // ref -> dense index
+
+    void moveElem(std::size_t from, std::size_t to) {
+        posX_[to]    = posX_[from];
+        posY_[to]    = posY_[from];
+        velX_[to]    = velX_[from];
+        velY_[to]    = velY_[from];
+        forceX_[to]  = forceX_[from];
+        forceY_[to]  = forceY_[from];
+        invMass_[to] = invMass_[from];
+        mass_[to]    = mass_[from];
+        fixed_[to]   = fixed_[from];
+        refs_[to]    = refs_[from];
+    }
+
+    void popBack(std::size_t n = 1) {
+        auto popN = [n](auto& vec) {
+            vec.erase(vec.end() - static_cast<std::ptrdiff_t>(n), vec.end());
+        };
+        popN(posX_);
+        popN(posY_);
+        popN(velX_);
+        popN(velY_);
+        popN(forceX_);
+        popN(forceY_);
+        popN(invMass_);
+        popN(mass_);
+        popN(fixed_);
+        popN(refs_);
+    }
+
+  public:
+    // if you do not store the return value you will only be able to retrive/delete this point
+    // through iteration
+    PointRef insert(const Point& p) {
+        PointRef ind{slots_.insert(size())};
+        posX_.push_back(p.pos.x);
+        posY_.push_back(p.pos.y);
+        velX_.push_back(p.vel.x);
+        velY_.push_back(p.vel.y);
+        forceX_.push_back(p.force.x);
+        forceY_.push_back(p.force.y);
+        invMass_.push_back(T(1) / p.mass);
+        mass_.push_back(p.mass);
+        fixed_.push_back(p.fixed);
+        refs_.push_back(ind);
+        return ind;
+    }
+
+    // bulk insert from columns of equal length, the new points take the dense indicies
+    // [returned value, size()) in order
+    std::size_t insert(std::span<const T> posX, std::span<const T> posY, std::span<const T> velX,
+                       std::span<const T> velY, std::span<const T> mass,
+                       std::span<const std::uint8_t> fixed) {
+        const std::size_t first = size();
+        const std::size_t n     = posX.size();
+        if (posY.size() != n || velX.size() != n || velY.size() != n || mass.size() != n ||
+            fixed.size() != n)
+            throw std::logic_error("Point columns differ in length");
+        reserve(first + n);
+        posX_.insert(posX_.end(), posX.begin(), posX.end());
+        posY_.insert(posY_.end(), posY.begin(), posY.end());
+        velX_.insert(velX_.end(), velX.begin(), velX.end());
+        velY_.insert(velY_.end(), velY.begin(), velY.end());
+        forceX_.resize(first + n);
+        forceY_.resize(first + n);
+        mass_.insert(mass_.end(), mass.begin(), mass.end());
+        for (T m: mass) invMass_.push_back(T(1) / m);
+        fixed_.insert(fixed_.end(), fixed.begin(), fixed.end());
+        slots_.reserve(first + n);
+        for (std::size_t i = first; i != first + n; ++i) {
+            refs_.push_back(PointRef{slots_.insert(i)});
+        }
+        return first;
+    }
+
+    // deletion changes underyling arrays and therefore invalidates dense indicies
+    void erase(const PointRef& ind) {
+        auto delIndex = slots_.index(ind.id);
+        auto back     = size() - 1;
+        slots_.erase(ind.id);
+        if (delIndex != back) {
+            moveElem(back, delIndex);
+            slots_.move(refs_[delIndex].id, delIndex);
+        }
+        popBack();
+    }
+
+    // one compaction pass over the arrays, O(n + k) however many are removed
+    template <std::ranges::forward_range R>
+        requires std::is_same_v<std::ranges::range_value_t<R>, PointRef>
+    void erase(R&& range) {
+        std::vector<std::uint8_t> doomed(size());
+        std::size_t               removed = 0;
+        for (const auto& ind: range) { // all looked up before anything changes
+            auto delIndex = slots_.index(ind.id);
+            if (doomed[delIndex] == 0) ++removed;
+            doomed[delIndex] = 1;
+        }
+        for (std::size_t i = 0; i != size(); ++i) {
+            if (doomed[i] != 0) slots_.erase(refs_[i].id);
+        }
+        details::fillHoles(doomed, removed, [&](std::size_t from, std::size_t to) {
+            moveElem(from, to);
+            slots_.move(refs_[to].id, to);
+        });
+        popBack(removed);
+    }
+
+    template <std::ranges::input_range R>
+    std::vector<PointRef> insert_range(R&& range) {
+        std::vector<PointRef> refs;
+        if constexpr (std::ranges::sized_range<R>) {
+            refs.reserve(std::ranges::size(range));
+            reserve(size() + std::ranges::size(range));
+        }
+        for (const Point& p: range) refs.push_back(insert(p));
+        return refs;
+    }
+
+    [[nodiscard]] Elem        front() const { return {refs_.front(), get(0)}; }
+    [[nodiscard]] Elem        back() const { return {refs_.back(), get(size() - 1)}; }
+    [[nodiscard]] bool        contains(const PointRef& ind) const {
+        return slots_.contains(ind.id);
+    }
+    [[nodiscard]] std::size_t size() const { return refs_.size(); }
+    [[nodiscard]] bool        empty() const { return refs_.empty(); }
+    void                      reserve(std::size_t n) {
+        posX_.reserve(n);
+        posY_.reserve(n);
+        velX_.reserve(n);
+        velY_.reserve(n);
+        forceX_.reserve(n);
+        forceY_.reserve(n);
+        invMass_.reserve(n);
+        mass_.reserve(n);
+        fixed_.reserve(n);
+        refs_.reserve(n);
+        slots_.reserve(n);
+    }
+    void clear() { // invalidates all refs previously made by this object
+        popBack(size());
+        slots_.clear();
+    }
+
+    // dense index of a point - only valid untill the next erase
+    [[nodiscard]] std::size_t index(const PointRef& ind) const { return slots_.index(ind.id); }
+    [[nodiscard]] PointRef    ref(std::size_t i) const { return refs_[i]; }
+
+    // gathers/scatters a whole point, prefer the field accessors in hot loops
+    [[nodiscard]] Point get(std::size_t i) const {
+        Point p{pos(i), mass_[i], vel(i), fixed_[i] != 0};
+        p.force = {forceX_[i], forceY_[i]};
+        return p;
+    }
+    void set(std::size_t i, const Point& p) {
+        setPos(i, p.pos);
+        setVel(i, p.vel);
+        forceX_[i]  = p.force.x;
+        forceY_[i]  = p.force.y;
+        invMass_[i] = T(1) / p.mass;
+        mass_[i]    = p.mass;
+        fixed_[i]   = p.fixed;
+    }
+    [[nodiscard]] Point operator[](const PointRef& ind) const { return get(index(ind)); }
+    void                set(const PointRef& ind, const Point& p) { set(index(ind), p); }
+
+    [[nodiscard]] Vec pos(std::size_t i) const { return {posX_[i], posY_[i]}; }
+    [[nodiscard]] Vec vel(std::size_t i) const { return {velX_[i], velY_[i]}; }
+    [[nodiscard]] Vec pos(const PointRef& ind) const { return pos(index(ind)); }
+    [[nodiscard]] Vec vel(const PointRef& ind) const { return vel(index(ind)); }
+    void              setPos(std::size_t i, const Vec& pos) {
+        posX_[i] = pos.x;
+        posY_[i] = pos.y;
+    }
+    void setVel(std::size_t i, const Vec& vel) {
+        velX_[i] = vel.x;
+        velY_[i] = vel.y;
+    }
+
+    [[nodiscard]] std::span<T>       posX() { return posX_; }
+    [[nodiscard]] std::span<T>       posY() { return posY_; }
+    [[nodiscard]] std::span<T>       velX() { return velX_; }
+    [[nodiscard]] std::span<T>       velY() { return velY_; }
+    [[nodiscard]] std::span<T>       forceX() { return forceX_; }
+    [[nodiscard]] std::span<T>       forceY() { return forceY_; }
+    [[nodiscard]] std::span<const T> posX() const { return posX_; }
+    [[nodiscard]] std::span<const T> posY() const { return posY_; }
+    [[nodiscard]] std::span<const T> velX() const { return velX_; }
+    [[nodiscard]] std::span<const T> velY() const { return velY_; }
+    [[nodiscard]] std::span<const T> forceX() const { return forceX_; }
+    [[nodiscard]] std::span<const T> forceY() const { return forceY_; }
+    [[nodiscard]] std::span<const T> invMass() const { return invMass_; }
+    [[nodiscard]] std::span<const T> mass() const { return mass_; }
+    [[nodiscard]] std::span<const std::uint8_t> fixed() const { return fixed_; }
+
+    [[nodiscard]] details::PointState<T> state() {
+        return {posX_.data(),   posY_.data(),   velX_.data(),    velY_.data(),
+                forceX_.data(), forceY_.data(), invMass_.data(), fixed_.data()};
+    }
+
+    // a non empty frozen is used in place of the fixed flags by the integration functions (the
+    // engine adds its sleeping points to it), the begin and end overloads only touch points in
+    // [begin, end) so disjoint ranges can run in parallel
+
+    // same integration as Point::update run over the whole array by the batch kernel
+    void update(T deltaTime, T gravity, std::span<const std::uint8_t> frozen,
+                std::size_t begin, std::size_t end) {
+        details::PointState<T> s = state();
+        if (!frozen.empty()) s.fixed = frozen.data();
+        details::integrate(s, begin, end, deltaTime, gravity);
+    }
+    void update(T deltaTime, T gravity, std::span<const std::uint8_t> frozen = {}) {
+        update(deltaTime, gravity, frozen, 0, size());
+    }
+
+    // pieces of the higher order integrators, fixed points are left alone
+    // velocity += acceleration * deltaTime (forces are kept)
+    void kick(T deltaTime, T gravity, std::span<const std::uint8_t> frozen,
+              std::size_t begin, std::size_t end) {
+        if (frozen.empty()) frozen = fixed_;
+        for (std::size_t i = begin; i != end; ++i) {
+            if (frozen[i]) continue;
+            velX_[i] += forceX_[i] * invMass_[i] * deltaTime;
+            velY_[i] += (forceY_[i] * invMass_[i] - gravity) * deltaTime;
+        }
+    }
+    void kick(T deltaTime, T gravity, std::span<const std::uint8_t> frozen = {}) {
+        kick(deltaTime, gravity, frozen, 0, size());
+    }
+    // position += velocity * deltaTime
+    void drift(T deltaTime, std::span<const std::uint8_t> frozen, std::size_t begin,
+               std::size_t end) {
+        if (frozen.empty()) frozen = fixed_;
+        for (std::size_t i = begin; i != end; ++i) {
+            if (frozen[i]) continue;
+            posX_[i] += velX_[i] * deltaTime;
+            posY_[i] += velY_[i] * deltaTime;
+        }
+    }
+    void drift(T deltaTime, std::span<const std::uint8_t> frozen = {}) {
+        drift(deltaTime, frozen, 0, size());
+    }
+    void clearForces() {
+        std::fill(forceX_.begin(), forceX_.end(), T(0));
+        std::fill(forceY_.begin(), forceY_.end(), T(0));
+    }
+
+  private:
+    struct ConstIterator {
+        using iterator_concept = std::bidirectional_iterator_tag;
+        using difference_type  = std::ptrdiff_t;
+        using value_type       = Elem;
+
+        ConstIterator() = default;
+        ConstIterator(const BasicPointStore* store_, std::size_t i_) : store(store_), i(i_) {}
+
+        [[nodiscard]] Elem operator*() const { return {store->refs_[i], store->get(i)}; }
+
+        ConstIterator& operator++() { // Prefix increment
+            ++i;
+            return *this;
+        }
+        ConstIterator operator++(int) { // Postfix increment
+            ConstIterator tmp = *this;
+            ++i;
+            return tmp;
+        }
+        ConstIterator& operator--() { // Prefix decrement
+            --i;
+            return *this;
+        }
+        ConstIterator operator--(int) { // Postfix decrement
+            ConstIterator tmp = *this;
+            --i;
+            return tmp;
+        }
+
+        friend bool operator==(const ConstIterator& a, const ConstIterator& b) {
+            return a.i == b.i;
+        }
+
+      private:
+        const BasicPointStore* store; // has to be pointer to be default initialisable
+        std::size_t            i;
+    };
+
+    static_assert(std::bidirectional_iterator<ConstIterator>);
+
+  public:
+    // iteration yields copies, write back through set
+    [[nodiscard]] ConstIterator begin() const { return cbegin(); }
+    [[nodiscard]] ConstIterator end() const { return cend(); }
+    [[nodiscard]] ConstIterator cbegin() const { return {this, 0}; }
+    [[nodiscard]] ConstIterator cend() const { return {this, size()}; }
+};
+
+using PointStore  = BasicPointStore<double>;
+using PointStoreF = BasicPointStore<float>;
+
+} // namespace physenv
@@ -2,107 +2,251 @@
 
 #include "Edge.hpp"
 #include "Point.hpp"
+#include "details/AlignedAllocator.hpp"
+#include "details/EdgeIndex.hpp"
+#include <ranges>
+#include <utility>
 #include <vector>
 
 namespace physenv {
 
-class Polygon {
+// vertices, edge normals and plane offsets are kept packed as structure of arrays, the edges are
+// views made on demand
+template <typename T>
+class BasicPolygon {
+  public:
+    using Vec   = details::Vector2<T>;
+    using Edge  = BasicEdge<T>;
+    using Point = BasicPoint<T>;
+
   private:
-    Vec2 maxBounds{};
-    Vec2 minBounds{};
+    Vec maxBounds{};
+    Vec minBounds{};
+    // packed geometry, edge i runs from vertex i to vertex i + 1 and vertex 0 is repeated at the
+    // back so that never wraps
+    details::AlignedVector<T> vertX{};
+    details::AlignedVector<T> vertY{};
+    // outward normal and offset of each edge
+    // pos is outside edge i when normalX[i] * pos.x + normalY[i] * pos.y > offset[i]
+    details::AlignedVector<T> normalX{};
+    details::AlignedVector<T> normalY{};
+    details::AlignedVector<T> offset{};
+    bool                      convex = false;
+    details::EdgeIndex<T>     index{}; // see buildIndex
+
+    [[nodiscard]] T planeDist(std::size_t i, const Vec& pos) const {
+        return normalX[i] * pos.x + normalY[i] * pos.y - offset[i];
+    }
+    [[nodiscard]] Vec diff(std::size_t i) const {
+        return {vertX[i + 1] - vertX[i], vertY[i + 1] - vertY[i]};
+    }
+
+    // signed distance to the edge pos is least inside of, negative for every edge means contained
+    // (if convex) and that edge is then the one of least penetration, branch free so it vectorises
+    [[nodiscard]] std::pair<T, std::size_t> deepest(const Vec& pos) const {
+        T           best        = -std::numeric_limits<T>::infinity();
+        std::size_t deepestEdge = 0;
+        for (std::size_t i = 0; i != offset.size(); ++i) {
+            T dist      = planeDist(i, pos);
+            deepestEdge = dist > best ? i : deepestEdge;
+            best        = dist > best ? dist : best;
+        }
+        return {best, deepestEdge};
+    }
+
+    // squared distance from pos to the segment of edge i
+    [[nodiscard]] T segmentSqDist(std::size_t i, const Vec& pos) const {
+        Vec d     = diff(i);
+        Vec toPos = pos - vertex(i);
+        T   len   = d.dot(d);
+        T   t     = len > 0 ? std::clamp(toPos.dot(d) / len, T(0), T(1)) : T(0);
+        Vec gap   = toPos - d * t;
+        return gap.dot(gap);
+    }
+
+    // pushes pos dist along the normal of edge i and reflects vel off it
+    void respond(Vec& pos, Vec& vel, std::size_t i, T dist) const {
+        Vec normal{normalX[i], normalY[i]};
+        pos = pos + normal * dist;
+        vel -= (T(2) * normal.dot(vel) * normal); // vector reflection formula
+    }
+
+    // updates bounds, direction, convexity and the edge planes from the vertices
+    void boundsUp() {
+        normalX.clear();
+        normalY.clear();
+        offset.clear();
+        if (vertX.empty()) return;
+        maxBounds = minBounds = vertex(0);
+        for (std::size_t i = 0; i != size(); ++i) { // loop over all points
+            maxBounds.x = std::max(maxBounds.x, vertX[i]);
+            maxBounds.y = std::max(maxBounds.y, vertY[i]);
+            minBounds.x = std::min(minBounds.x, vertX[i]);
+            minBounds.y = std::min(minBounds.y, vertY[i]);
+        }
+
+        // winding from the signed area, a single corner can be reflex unless the polygon is convex
+        T area = 0;
+        for (std::size_t i = 0; i != size(); ++i) area += vertex(i).cross(vertex(i + 1));
+        direction = std::signbit(area);
+        convex    = std::signbit(diff(size() - 1).cross(diff(0))) == direction; // first and last
+        for (std::size_t i = 0; i != size() - 1; ++i) {
+            if (std::signbit(diff(i).cross(diff(i + 1))) != direction) convex = false;
+        }
+
+        for (std::size_t i = 0; i != size(); ++i) {
+            // note if clockwise (!dir) - normals are correct
+            Vec normal = T((direction) ? 1 : -1) * edge(i).normal();
+            normalX.push_back(normal.x);
+            normalY.push_back(normal.y);
+            offset.push_back(normal.dot(vertex(i)));
+        }
+        if (!index.empty()) buildIndex();
+    }
 
   public:
-    std::vector<Edge> edges{};
-    bool              direction; // the way round the points go - true is anticlockwise
+    bool direction; // the way round the points go - true is anticlockwise
 
-    explicit Polygon() = default;
+    explicit BasicPolygon() = default;
 
-    explicit Polygon(const std::vector<Vec2>& points) {
+    explicit BasicPolygon(const std::vector<Vec>& points) {
         if (points.size() == 1)
             throw std::logic_error("Polygon cannot be constructed with 1 point");
 
-        for (std::size_t i = 0; i != points.size() - 1; i++) {
-            edges.push_back({points[i], points[i + 1]});
+        vertX.reserve(points.size() + 1);
+        vertY.reserve(points.size() + 1);
+        for (const Vec& point: points) {
+            vertX.push_back(point.x);
+            vertY.push_back(point.y);
         }
-        edges.push_back({points[points.size() - 1], points[0]}); // for last one
-        boundsUp();
-        isConvex(); // updates the direction variable ;)
+        if (!points.empty()) { // for last one
+            vertX.push_back(points.front().x);
+            vertY.push_back(points.front().y);
+        }
+        boundsUp(); // updates the direction variable ;)
     }
 
-    // updates bounds of polygon
-    void boundsUp() {
-        for (const Edge& edge: edges) { // loop over all points
-            const Vec2& vert = edge.p1();
-            maxBounds.x      = std::max(maxBounds.x, vert.x);
-            maxBounds.y      = std::max(maxBounds.y, vert.y);
-            minBounds.x      = std::min(minBounds.x, vert.x);
-            minBounds.y      = std::min(minBounds.y, vert.y);
+    [[nodiscard]] const Vec& min() const { return minBounds; }
+    [[nodiscard]] const Vec& max() const { return maxBounds; }
+
+    // number of vertices, and so edges
+    [[nodiscard]] std::size_t size() const { return vertX.empty() ? 0 : vertX.size() - 1; }
+    [[nodiscard]] Vec         vertex(std::size_t i) const { return {vertX[i], vertY[i]}; }
+    [[nodiscard]] Edge        edge(std::size_t i) const { return {vertex(i), vertex(i + 1)}; }
+
+    // views of the edges in order, built on the fly from the packed vertices
+    [[nodiscard]] auto edges() const {
+        return std::views::iota(std::size_t{0}, size()) |
+               std::views::transform([this](std::size_t i) { return edge(i); });
+    }
+
+    // builds an edge index that takes isContained and colHandler from O(edges) to about
+    // O(log edges), worth it for detailed outlines of a few hundred edges or more
+    // kept up to date by setVertex from then on
+    // with the index the closest edge is the closest segment rather than the closest edge line,
+    // the same thing for points inside a convex polygon
+    void buildIndex() { index.build(vertX, vertY, size()); }
+    void clearIndex() { index.clear(); }
+    [[nodiscard]] bool indexed() const { return !index.empty(); }
+
+    // moves vertex i, the edges either side go with it
+    void setVertex(std::size_t i, const Vec& pos) {
+        vertX[i] = pos.x;
+        vertY[i] = pos.y;
+        if (i == 0) {
+            vertX.back() = pos.x;
+            vertY.back() = pos.y;
         }
+        boundsUp();
     }
 
-    bool isBounded(const Vec2& pos) const {
+    bool isBounded(const Vec& pos) const {
         return pos.x >= minBounds.x && pos.y >= minBounds.y && pos.x <= maxBounds.x &&
                pos.y <= maxBounds.y;
     }
 
-    bool isContained(const Vec2& pos) const {
+    bool isContained(const Vec& pos) const {
+        if (indexed()) { // only the edges sharing pos's slab can cross the ray
+            bool contained = false;
+            for (std::size_t i: index.slab(pos.x))
+                if (edge(i).rayCast(pos)) contained = !contained;
+            return contained;
+        }
+        if (convex) return deepest(pos).first < 0; // inside every half plane
         bool contained = false;
-        for (const Edge& edge: edges)
-            if (edge.rayCast(pos)) contained = !contained;
+        for (std::size_t i = 0; i != size(); ++i)
+            if (edge(i).rayCast(pos)) contained = !contained;
         return contained;
     }
 
     // checks if polygon is convex
-    bool isConvex() {
-        direction =
-            std::signbit((edges.back().diff()).cross(edges.front().diff())); // first and last
+    [[nodiscard]] bool isConvex() const { return convex; }
 
-        for (std::size_t i = 0; i != edges.size() - 1; ++i) {
-            if (std::signbit(edges[i].diff().cross(edges[i + 1].diff())) != direction)
-                return false; // checks up untill edge size - 1
+    // handle collision between point p and this
+    void colHandler(Point& p) const { colHandler(p.pos, p.vel); }
+
+    // handle collision between a point with pos and vel and this, pushed out through the closest
+    // edge
+    void colHandler(Vec& pos, Vec& vel) const {
+        if (size() == 0) return;
+        if (indexed()) {
+            auto [closest, sqDist] =
+                index.nearest(pos, [&](std::size_t i) { return segmentSqDist(i, pos); });
+            respond(pos, vel, closest, std::abs(planeDist(closest, pos)));
+            return;
         }
-        return true;
+        T           closestDist = std::numeric_limits<T>::infinity();
+        std::size_t closest     = 0;
+        for (std::size_t i = 0; i != size(); ++i) {
+            T dist      = std::abs(planeDist(i, pos));
+            closest     = dist < closestDist ? i : closest;
+            closestDist = dist < closestDist ? dist : closestDist;
+        }
+        respond(pos, vel, closest, closestDist);
     }
 
-    // handle collision between point p and this
-    void colHandler(Point& p) const {
-        double closestDist = std::numeric_limits<double>::infinity();
-        Vec2   closestPos;
-        Vec2   normal;
-
-        for (const Edge& edge: edges) {
-            double dist = edge.distToPoint(p.pos);
-            if (dist < closestDist) { // if new closest edge
-                closestDist = dist;
-                // note if clockwise (!dir) - normals are correct
-                normal     = ((direction) ? 1 : -1) * edge.normal();
-                closestPos = p.pos + normal * dist;
-            }
+    // containment test and collision response together, convex polygons take one pass over the
+    // edge planes instead of a ray cast and a sweep for the closest edge
+    // returns whether pos was inside
+    bool collide(Vec& pos, Vec& vel) const {
+        if (!convex || indexed()) {
+            if (!isContained(pos)) return false;
+            colHandler(pos, vel);
+            return true;
         }
-        p.pos = closestPos;
-        p.vel -= (2 * normal.dot(p.vel) * normal); // vector reflection formula
+        auto [dist, edge] = deepest(pos);
+        if (dist >= 0) return false;
+        respond(pos, vel, edge, -dist);
+        return true;
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Polygon& p) {
-        if (!p.edges.empty()) {
-            os << p.edges[0].p1();
-            for (std::size_t i = 1; i != p.edges.size(); ++i) {
-                os << ' ' << p.edges[i].p1();
+    friend std::ostream& operator<<(std::ostream& os, const BasicPolygon& p) {
+        if (p.size() != 0) {
+            os << p.vertex(0);
+            for (std::size_t i = 1; i != p.size(); ++i) {
+                os << ' ' << p.vertex(i);
             }
         }
         return os;
     }
 
     // static stuff
-    static Polygon Square(const Vec2& pos, double tilt) {
-        return Polygon({pos, Vec2(10, 0) + pos, Vec2(10, 1 + tilt) + pos, Vec2(0, 1 - tilt) + pos});
+    static BasicPolygon Square(const Vec& pos, T tilt) {
+        return BasicPolygon(
+            {pos, Vec(10, 0) + pos, Vec(10, 1 + tilt) + pos, Vec(0, 1 - tilt) + pos});
     }
 
-    static Polygon Triangle(Vec2 pos) {
-        return Polygon({Vec2(1, 1) + pos, Vec2(-1, 1) + pos, Vec2(0, -1) + pos});
+    static BasicPolygon Triangle(Vec pos) {
+        return BasicPolygon({Vec(1, 1) + pos, Vec(-1, 1) + pos, Vec(0, -1) + pos});
     }
 };
 
-using PolyRef = details::Ref<Polygon>;
+using Polygon  = BasicPolygon<double>;
+using PolygonF = BasicPolygon<float>;
+
+template <typename T>
+using BasicPolyRef = details::Ref<BasicPolygon<T>>;
+using PolyRef      = BasicPolyRef<double>;
+using PolyRefF     = BasicPolyRef<float>;
 
 } // namespace physenv
\ No newline at end of file
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "details/RingBuffer.hpp"
+
+// define PHYSENV_PROFILE (or configure with -DPHYSENV_PROFILE=ON) to have Engine::simFrame record
+// per phase times and counters, without it Profiler is empty and every call is a no op
+
+namespace physenv {
+
+// time spent in nested phases is only counted against the innermost one
+enum class Phase {
+    Springs,     // spring force evaluation, every evaluation of the multi stage integrators
+    Integrate,   // integrator excluding its spring forces
+    BroadPhase,  // building the polygon grid
+    NarrowPhase, // bounds and containment tests of the candidates plus collision response
+    Other,       // deferred removals and index rebuilds
+    Count
+};
+
+struct FrameCounters {
+    std::size_t springs           = 0; // spring evaluations
+    std::size_t boundedChecks     = 0; // Polygon::isBounded calls
+    std::size_t containmentChecks = 0; // bounded checks that passed so Polygon::collide ran
+    std::size_t collisions        = 0; // points pushed out of a polygon
+};
+
+struct FrameStats {
+    std::array<double, static_cast<std::size_t>(Phase::Count)> seconds{};
+    FrameCounters                                               counters{};
+
+    [[nodiscard]] double time(Phase phase) const {
+        return seconds[static_cast<std::size_t>(phase)];
+    }
+    [[nodiscard]] double total() const {
+        double sum = 0;
+        for (double s: seconds) sum += s;
+        return sum;
+    }
+};
+
+// summary of the frames in the profiler's window
+struct ProfileSnapshot {
+    std::size_t frames = 0; // frames in the window
+    FrameStats  last{};
+    FrameStats  mean{};
+    FrameStats  max{}; // per field max, not the slowest frame
+};
+
+#ifdef PHYSENV_PROFILE
+
+class Profiler {
+    using Clock = std::chrono::steady_clock;
+
+    details::RingBuffer<FrameStats> history;
+    FrameStats                      current{};
+    FrameStats                      lastFrame{};
+    Clock::time_point               mark{};
+    Phase                           active = Phase::Count; // Count while outside a frame
+
+    void charge(Clock::time_point now) {
+        if (active != Phase::Count) {
+            current.seconds[static_cast<std::size_t>(active)] +=
+                std::chrono::duration<double>(now - mark).count();
+        }
+        mark = now;
+    }
+
+  public:
+    static constexpr bool enabled = true;
+
+    // restores the enclosing phase when it goes out of scope
+    class Scope {
+        Profiler* profiler;
+        Phase     previous;
+
+      public:
+        Scope(Profiler& p, Phase phase) : profiler(&p), previous(p.active) {
+            p.charge(Clock::now());
+            p.active = phase;
+        }
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            profiler->charge(Clock::now());
+            profiler->active = previous;
+        }
+    };
+
+    // a frame is timed as Phase::Other until a nested scope takes over, closing the outermost
+    // one commits it to the window
+    class FrameScope {
+        Profiler* profiler;
+        Phase     previous;
+
+      public:
+        explicit FrameScope(Profiler& p) : profiler(&p), previous(p.active) {
+            p.charge(Clock::now());
+            p.active = Phase::Other;
+        }
+        FrameScope(const FrameScope&)            = delete;
+        FrameScope& operator=(const FrameScope&) = delete;
+        ~FrameScope() {
+            profiler->charge(Clock::now());
+            profiler->active = previous;
+            if (previous == Phase::Count) profiler->commit();
+        }
+    };
+
+    explicit Profiler(std::size_t window = 120) : history(std::max(window, std::size_t{1})) {}
+
+    [[nodiscard]] Scope      scope(Phase phase) { return {*this, phase}; }
+    [[nodiscard]] FrameScope frame() { return FrameScope{*this}; }
+
+    void add(const FrameCounters& counts) {
+        current.counters.springs           += counts.springs;
+        current.counters.boundedChecks     += counts.boundedChecks;
+        current.counters.containmentChecks += counts.containmentChecks;
+        current.counters.collisions        += counts.collisions;
+    }
+
+    void commit() {
+        history.add(current);
+        lastFrame = current;
+        current   = {};
+    }
+
+    // O(window), cheap enough to poll every frame from a dashboard
+    [[nodiscard]] ProfileSnapshot snapshot() const {
+        ProfileSnapshot snap;
+        snap.frames = history.size;
+        snap.last   = lastFrame;
+        if (history.size == 0) return snap;
+        // applies f to the matching counters of each argument
+        auto each = [](auto&& f, auto&... c) {
+            f(c.springs...);
+            f(c.boundedChecks...);
+            f(c.containmentChecks...);
+            f(c.collisions...);
+        };
+        std::array<double, 4> sums{};
+        for (const FrameStats& frame: history.v) {
+            for (std::size_t p = 0; p != frame.seconds.size(); ++p) {
+                snap.mean.seconds[p] += frame.seconds[p];
+                snap.max.seconds[p]   = std::max(snap.max.seconds[p], frame.seconds[p]);
+            }
+            double* sum = sums.data();
+            each([&](std::size_t in, std::size_t& max) {
+                *sum++ += static_cast<double>(in);
+                max     = std::max(max, in);
+            }, frame.counters, snap.max.counters);
+        }
+        const auto n = static_cast<double>(history.size);
+        for (double& s: snap.mean.seconds) s /= n;
+        const double* sum = sums.data();
+        each([&](std::size_t& mean) { mean = static_cast<std::size_t>(*sum++ / n + 0.5); },
+             snap.mean.counters);
+        return snap;
+    }
+
+    // frames in the window, oldest first
+    template <typename F>
+    void forEachFrame(F&& visit) const {
+        for (std::size_t i = 0; i != history.size; ++i) {
+            visit(history.v[(history.pos + i) % history.size]);
+        }
+    }
+
+    void reset() {
+        history.reset();
+        current   = {};
+        lastFrame = {};
+    }
+};
+
+#else
+
+class Profiler {
+  public:
+    static constexpr bool enabled = false;
+
+    struct Scope {};
+    struct FrameScope {};
+
+    explicit Profiler(std::size_t /*window*/ = 120) {}
+
+    [[nodiscard]] Scope      scope(Phase /*phase*/) { return {}; }
+    [[nodiscard]] FrameScope frame() { return {}; }
+
+    void                          add(const FrameCounters& /*counts*/) {}
+    void                          commit() {}
+    [[nodiscard]] ProfileSnapshot snapshot() const { return {}; }
+    template <typename F>
+    void forEachFrame(F&& /*visit*/) const {}
+    void reset() {}
+};
+
+#endif
+
+} // namespace physenv
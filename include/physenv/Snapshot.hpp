@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Persistance.hpp"
+#include "details/MappedFile.hpp"
+
+// binary snapshots - every column is written raw and padded to 64 bytes so loading is a memory
+// map plus bulk copies, no parsing
+// layout: header | points: posX posY velX velY mass fixed | springs: springConst dampFact
+// naturalLength p1 p2 (point indicies) | polygons: vertex offsets (count + 1) vertX vertY
+
+namespace persisitance {
+
+namespace snapshot {
+
+inline constexpr std::array<char, 8> Magic{'P', 'H', 'Y', 'S', 'S', 'N', 'A', 'P'};
+inline constexpr std::uint32_t       Version     = 1;
+inline constexpr std::uint32_t       EndianCheck = 0x01020304;
+inline constexpr std::size_t         Alignment   = 64;
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t       version;
+    std::uint32_t       endian;
+    std::uint64_t       pointCount;
+    std::uint64_t       springCount;
+    std::uint64_t       polyCount;
+    std::uint64_t       vertexCount;
+};
+
+inline std::size_t padded(std::size_t bytes) {
+    return (bytes + Alignment - 1) / Alignment * Alignment;
+}
+
+template <typename T>
+void writeColumn(std::ostream& os, std::span<const T> column) {
+    static constexpr std::array<char, Alignment> zeros{};
+    std::size_t                                  bytes = column.size_bytes();
+    os.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(bytes));
+    os.write(zeros.data(), static_cast<std::streamsize>(padded(bytes) - bytes));
+}
+
+// reads columns sequentially out of a mapped file
+class Reader {
+  private:
+    std::span<const std::byte> bytes;
+    std::size_t                offset = 0;
+
+  public:
+    explicit Reader(std::span<const std::byte> bytes_) : bytes(bytes_) {}
+
+    template <typename T>
+    std::span<const T> column(std::size_t count) {
+        std::size_t size = count * sizeof(T);
+        if (count > bytes.size() / sizeof(T) || offset + size > bytes.size())
+            throw std::runtime_error("Snapshot truncated - file invalid");
+        auto col = std::span(reinterpret_cast<const T*>(bytes.data() + offset), count);
+        offset += padded(size);
+        return col;
+    }
+};
+
+} // namespace snapshot
+
+inline void saveSnapshot(const physenv::Engine& eng, std::filesystem::path path,
+                         ObjectEnabled enabled) {
+    using namespace snapshot;
+    path.make_preferred();
+    std::ofstream file{path, std::ios_base::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("Falied to open fstream \n");
+    }
+
+    // springs reference points by their dense index so can only be saved with them
+    const auto& pts     = eng.points;
+    bool        springs = enabled.springs && enabled.points;
+    Header      header{Magic, Version, EndianCheck, enabled.points ? pts.size() : 0,
+                  springs ? eng.springs.size() : 0, enabled.polygons ? eng.polys.size() : 0, 0};
+
+    std::vector<std::uint64_t> vertStart{0};
+    std::vector<double>        vertX;
+    std::vector<double>        vertY;
+    if (enabled.polygons) {
+        for (const auto& p: eng.polys) {
+            for (const auto& edge: p.obj.edges()) {
+                vertX.push_back(edge.p1().x);
+                vertY.push_back(edge.p1().y);
+            }
+            vertStart.push_back(vertX.size());
+        }
+    }
+    header.vertexCount = vertX.size();
+    writeColumn(file, std::span<const Header>(&header, 1));
+
+    if (enabled.points) {
+        writeColumn(file, pts.posX());
+        writeColumn(file, pts.posY());
+        writeColumn(file, pts.velX());
+        writeColumn(file, pts.velY());
+        writeColumn(file, pts.mass());
+        writeColumn(file, pts.fixed());
+    }
+
+    if (springs) {
+        std::vector<double>        springConst;
+        std::vector<double>        dampFact;
+        std::vector<double>        naturalLength;
+        std::vector<std::uint64_t> p1;
+        std::vector<std::uint64_t> p2;
+        for (const auto& s: eng.springs) {
+            springConst.push_back(s.obj.springConst);
+            dampFact.push_back(s.obj.dampFact);
+            naturalLength.push_back(s.obj.naturalLength);
+            p1.push_back(pts.index(s.obj.p1));
+            p2.push_back(pts.index(s.obj.p2));
+        }
+        writeColumn<double>(file, springConst);
+        writeColumn<double>(file, dampFact);
+        writeColumn<double>(file, naturalLength);
+        writeColumn<std::uint64_t>(file, p1);
+        writeColumn<std::uint64_t>(file, p2);
+    }
+
+    if (enabled.polygons) {
+        writeColumn<std::uint64_t>(file, vertStart);
+        writeColumn<double>(file, vertX);
+        writeColumn<double>(file, vertY);
+    }
+    if (!file.good()) throw std::runtime_error("Failed writing snapshot \"" + path.string() + '"');
+}
+
+inline void loadSnapshot(physenv::Engine& eng, std::filesystem::path path, bool replace,
+                         ObjectEnabled enabled) {
+    using namespace snapshot;
+    path.make_preferred();
+    if (replace) {
+        eng.clear();
+    }
+
+    physenv::details::MappedFile map{path};
+    Reader                       reader{map.bytes()};
+    Header                       header = reader.column<Header>(1)[0];
+    if (header.magic != Magic) throw std::runtime_error("Not a snapshot - magic invalid");
+    if (header.endian != EndianCheck)
+        throw std::runtime_error("Snapshot was written with a different byte order");
+    if (header.version != Version)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+
+    auto posX  = reader.column<double>(header.pointCount);
+    auto posY  = reader.column<double>(header.pointCount);
+    auto velX  = reader.column<double>(header.pointCount);
+    auto velY  = reader.column<double>(header.pointCount);
+    auto mass  = reader.column<double>(header.pointCount);
+    auto fixed = reader.column<std::uint8_t>(header.pointCount);
+    if (enabled.points) {
+        eng.points.insert(posX, posY, velX, velY, mass, fixed);
+    }
+    std::size_t firstPoint = eng.points.size() - (enabled.points ? header.pointCount : 0);
+
+    auto springConst   = reader.column<double>(header.springCount);
+    auto dampFact      = reader.column<double>(header.springCount);
+    auto naturalLength = reader.column<double>(header.springCount);
+    auto p1            = reader.column<std::uint64_t>(header.springCount);
+    auto p2            = reader.column<std::uint64_t>(header.springCount);
+    if (enabled.springs && header.springCount != 0) {
+        if (!enabled.points) throw std::runtime_error("Springs can't be loaded without points");
+        eng.springs.reserve(eng.springs.size() + header.springCount);
+        for (std::size_t s = 0; s != header.springCount; ++s) {
+            if (p1[s] >= header.pointCount || p2[s] >= header.pointCount)
+                throw std::runtime_error("Spring references a point that doesn't exist");
+            eng.addSpring(physenv::Spring{springConst[s], dampFact[s], naturalLength[s],
+                                          eng.points.ref(firstPoint + p1[s]),
+                                          eng.points.ref(firstPoint + p2[s])});
+        }
+    }
+
+    auto vertStart = reader.column<std::uint64_t>(header.polyCount + 1);
+    auto vertX     = reader.column<double>(header.vertexCount);
+    auto vertY     = reader.column<double>(header.vertexCount);
+    if (enabled.polygons) {
+        std::vector<physenv::Vec2> verts;
+        for (std::size_t p = 0; p != header.polyCount; ++p) {
+            if (vertStart[p] > vertStart[p + 1] || vertStart[p + 1] > header.vertexCount ||
+                vertStart[p + 1] - vertStart[p] < 3)
+                throw std::runtime_error("Polygon vertex range invalid");
+            verts.clear();
+            for (std::size_t v = vertStart[p]; v != vertStart[p + 1]; ++v) {
+                verts.emplace_back(vertX[v], vertY[v]);
+            }
+            physenv::Polygon poly{verts};
+            if (poly.isConvex() == false)
+                throw std::runtime_error("Polygon vertices do not form a convex polygon");
+            eng.polys.insert(poly);
+        }
+    }
+}
+
+} // namespace persisitance
@@ -4,35 +4,48 @@
 
 namespace physenv {
 
-struct Spring {
-    double   springConst;
-    double   dampFact;
-    double   naturalLength;
-    PointRef p1;
-    PointRef p2;
-
-    void springHandler(Point& point1, Point& point2) const {
-        Vec2 force = forceCalc(point1, point2);
+template <typename T>
+struct BasicSpring {
+    using Vec = details::Vector2<T>;
+
+    T                springConst;
+    T                dampFact;
+    T                naturalLength;
+    BasicPointRef<T> p1;
+    BasicPointRef<T> p2;
+
+    void springHandler(BasicPoint<T>& point1, BasicPoint<T>& point2) const {
+        Vec force = forceCalc(point1, point2);
         point1.force += force; // equal and opposite reaction
         point2.force -= force;
     }
 
-    Vec2 forceCalc(const Point& point1, const Point& point2) const {
-        Vec2 diff = point1.pos - point2.pos; // broken out alot "yes this is faster! really like 3x"
-        double diffMag = diff.mag();
-        if (diffMag < 1E-30) return {}; // prevent 0 length spring exploding sim
-        Vec2   unitDiff = diff / diffMag;
-        double ext      = diffMag - naturalLength;
-        double springf  = -springConst * ext;                               // f = -ke hookes law
-        double dampf    = unitDiff.dot(point2.vel - point1.vel) * dampFact; // damping force
+    Vec forceCalc(const BasicPoint<T>& point1, const BasicPoint<T>& point2) const {
+        return forceCalc(point1.pos - point2.pos, point2.vel - point1.vel);
+    }
+
+    // diff is pos1 - pos2 and relVel is vel2 - vel1
+    Vec forceCalc(const Vec& diff, const Vec& relVel) const {
+        T diffMag = diff.mag(); // broken out alot "yes this is faster! really like 3x"
+        if (diffMag < T(1E-30)) return {}; // prevent 0 length spring exploding sim
+        Vec unitDiff = diff / diffMag;
+        T   ext      = diffMag - naturalLength;
+        T   springf  = -springConst * ext;              // f = -ke hookes law
+        T   dampf    = unitDiff.dot(relVel) * dampFact; // damping force
         return (springf + dampf) * unitDiff;
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Spring& s) {
+    friend std::ostream& operator<<(std::ostream& os, const BasicSpring& s) {
         return os << s.springConst << ' ' << s.naturalLength << ' ' << s.dampFact << ' ';
     }
 };
 
-using SpringRef = details::Ref<Spring>;
+using Spring  = BasicSpring<double>;
+using SpringF = BasicSpring<float>;
+
+template <typename T>
+using BasicSpringRef = details::Ref<BasicSpring<T>>;
+using SpringRef      = BasicSpringRef<double>;
+using SpringRefF     = BasicSpringRef<float>;
 
-} // namespace physenv
\ No newline at end of file
+} // namespace physenv
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Engine.hpp"
+#include "details/DeltaKernel.hpp"
+#include "details/MappedFile.hpp"
+
+// streaming trajectory files - one block per recorded frame holding the point positions and
+// velocities, either as raw doubles (keyframe) or as deltas from the previous frame quantized to
+// a fixed step and packed into the narrowest integer that fits
+// a keyframe index is appended on close so readers can seek, unfinished files are scanned instead
+
+namespace persisitance {
+
+namespace trajectory {
+
+inline constexpr std::array<char, 8> Magic{'P', 'H', 'Y', 'S', 'T', 'R', 'A', 'J'};
+inline constexpr std::array<char, 8> IndexMagic{'T', 'R', 'A', 'J', 'I', 'N', 'D', 'X'};
+inline constexpr std::uint32_t       Version     = 1;
+inline constexpr std::uint32_t       EndianCheck = 0x01020304;
+
+enum class FrameKind : std::uint32_t { Key, Delta };
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint32_t       version;
+    std::uint32_t       endian;
+    double              posQuantum;
+    double              velQuantum;
+};
+
+struct FrameHeader {
+    std::uint64_t frame;
+    std::uint64_t pointCount;
+    FrameKind     kind;
+    std::uint32_t width; // bytes per delta
+};
+
+struct IndexEntry {
+    std::uint64_t frame;
+    std::uint64_t offset;
+};
+
+struct Footer {
+    std::uint64_t       indexOffset;
+    std::uint64_t       keyframeCount;
+    std::uint64_t       frameCount;
+    std::array<char, 8> magic;
+};
+
+inline std::size_t payloadSize(const FrameHeader& header) {
+    return 4 * header.pointCount * (header.kind == FrameKind::Key ? sizeof(double) : header.width);
+}
+
+} // namespace trajectory
+
+struct TrajectorySettings {
+    std::size_t keyframeInterval = 64;   // frames between forced keyframes
+    double      posQuantum       = 1E-6; // delta step for positions
+    double      velQuantum       = 1E-6; // delta step for velocities
+};
+
+// appends the state of eng's points to a file each time record() is called, usually once per
+// simFrame or step
+class TrajectoryRecorder {
+  private:
+    const physenv::Engine&              eng;
+    TrajectorySettings                  settings;
+    std::ofstream                       file;
+    std::vector<trajectory::IndexEntry> keyframes;
+    std::array<std::vector<double>, 4>  recon; // values the reader will reconstruct
+    std::vector<std::int32_t>           quant;
+    std::vector<std::byte>              packed;
+    std::uint64_t                       frame = 0;
+
+    [[nodiscard]] std::array<std::span<const double>, 4> columns() const {
+        const auto& pts = eng.points;
+        return {pts.posX(), pts.posY(), pts.velX(), pts.velY()};
+    }
+
+    void write(const void* data, std::size_t bytes) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    }
+
+    void writeKeyframe() {
+        auto                    cols = columns();
+        trajectory::FrameHeader header{frame, cols[0].size(), trajectory::FrameKind::Key, 0};
+        keyframes.push_back({frame, static_cast<std::uint64_t>(file.tellp())});
+        write(&header, sizeof(header));
+        for (std::size_t c = 0; c != cols.size(); ++c) {
+            write(cols[c].data(), cols[c].size_bytes());
+            recon[c].assign(cols[c].begin(), cols[c].end());
+        }
+    }
+
+    // false if a delta doesn't fit in 32 bits, a keyframe is written instead (which also resets
+    // recon, so the kernel can advance it in the same pass)
+    bool writeDelta() {
+        auto              cols = columns();
+        const std::size_t n    = cols[0].size();
+        double            most = 0;
+        quant.resize(4 * n);
+        for (std::size_t c = 0; c != cols.size(); ++c) {
+            double quantum = c < 2 ? settings.posQuantum : settings.velQuantum;
+            double maxAbs  = physenv::details::quantizeDeltas(cols[c].data(), recon[c].data(),
+                                                              quant.data() + c * n, 0, n, quantum);
+            if (!(maxAbs <= std::numeric_limits<std::int32_t>::max())) return false;
+            most = std::max(most, maxAbs);
+        }
+
+        std::uint32_t width = most <= std::numeric_limits<std::int8_t>::max()    ? 1
+                              : most <= std::numeric_limits<std::int16_t>::max() ? 2
+                                                                                 : 4;
+        auto pack = [&]<typename T>(T) {
+            packed.resize(quant.size() * sizeof(T));
+            physenv::details::narrow(quant.data(), reinterpret_cast<T*>(packed.data()), 0,
+                                     quant.size());
+            return packed.data();
+        };
+        const void* data = width == 1   ? pack(std::int8_t{})
+                           : width == 2 ? pack(std::int16_t{})
+                                        : static_cast<const void*>(quant.data());
+
+        trajectory::FrameHeader header{frame, n, trajectory::FrameKind::Delta, width};
+        write(&header, sizeof(header));
+        write(data, quant.size() * width);
+        return true;
+    }
+
+    void finish() {
+        trajectory::Footer footer{static_cast<std::uint64_t>(file.tellp()), keyframes.size(),
+                                  frame, trajectory::IndexMagic};
+        write(keyframes.data(), keyframes.size() * sizeof(trajectory::IndexEntry));
+        write(&footer, sizeof(footer));
+        file.close();
+    }
+
+  public:
+    TrajectoryRecorder(const physenv::Engine& eng_, std::filesystem::path path,
+                       TrajectorySettings settings_ = {})
+        : eng(eng_), settings(settings_) {
+        if (settings.keyframeInterval == 0 || !(settings.posQuantum > 0) ||
+            !(settings.velQuantum > 0))
+            throw std::invalid_argument("Trajectory settings invalid");
+        path.make_preferred();
+        file.open(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file \"" + path.string() + '"');
+        }
+        trajectory::FileHeader header{trajectory::Magic, trajectory::Version,
+                                      trajectory::EndianCheck, settings.posQuantum,
+                                      settings.velQuantum};
+        write(&header, sizeof(header));
+    }
+
+    TrajectoryRecorder(const TrajectoryRecorder&)            = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    ~TrajectoryRecorder() {
+        if (file.is_open()) finish();
+    }
+
+    // point count changes force a keyframe
+    void record() {
+        bool key = frame % settings.keyframeInterval == 0 || recon[0].size() != eng.points.size();
+        if (key || !writeDelta()) writeKeyframe();
+        ++frame;
+    }
+
+    [[nodiscard]] std::size_t frames() const { return frame; }
+
+    // writes the keyframe index, further record() calls are invalid
+    void close() {
+        finish();
+        if (file.fail()) throw std::runtime_error("Failed writing trajectory");
+    }
+};
+
+// one decoded frame, columns are indexed by the dense point index at record time
+struct TrajectoryFrame {
+    std::size_t         frame = 0;
+    std::vector<double> posX{};
+    std::vector<double> posY{};
+    std::vector<double> velX{};
+    std::vector<double> velY{};
+};
+
+// memory maps a trajectory file and decodes frames on demand
+class TrajectoryReader {
+  private:
+    physenv::details::MappedFile        map;
+    trajectory::FileHeader              header{};
+    std::vector<trajectory::IndexEntry> keyframes;
+    std::size_t                         frameCount = 0;
+    std::size_t                         dataEnd    = 0; // end of the frame blocks
+
+    template <typename T>
+    [[nodiscard]] T load(std::size_t offset) const {
+        auto bytes = map.bytes();
+        if (offset > bytes.size() || bytes.size() - offset < sizeof(T))
+            throw std::runtime_error("Trajectory truncated - file invalid");
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    [[nodiscard]] trajectory::FrameHeader frameHeader(std::size_t offset) const {
+        if (offset > dataEnd) throw std::runtime_error("Trajectory index invalid - file invalid");
+        auto frameHead = load<trajectory::FrameHeader>(offset);
+        if ((frameHead.kind != trajectory::FrameKind::Key &&
+             frameHead.kind != trajectory::FrameKind::Delta) ||
+            (frameHead.kind == trajectory::FrameKind::Delta && frameHead.width != 1 &&
+             frameHead.width != 2 && frameHead.width != 4) ||
+            frameHead.pointCount > (dataEnd - offset) / sizeof(double))
+            throw std::runtime_error("Trajectory frame invalid - file invalid");
+        return frameHead;
+    }
+
+    // rebuilds the index of a file whose recorder never closed, a partial last frame is dropped
+    void scan() {
+        std::size_t offset = sizeof(trajectory::FileHeader);
+        while (dataEnd - offset >= sizeof(trajectory::FrameHeader)) {
+            auto        frameHead = frameHeader(offset);
+            std::size_t end = offset + sizeof(frameHead) + trajectory::payloadSize(frameHead);
+            if (end > dataEnd || frameHead.frame != frameCount) break;
+            if (frameHead.kind == trajectory::FrameKind::Key) {
+                keyframes.push_back({frameCount, offset});
+            }
+            ++frameCount;
+            offset = end;
+        }
+    }
+
+    void decode(std::size_t offset, TrajectoryFrame& out) const {
+        auto              frameHead = frameHeader(offset);
+        const std::size_t n         = frameHead.pointCount;
+        const std::byte*  payload   = map.bytes().data() + offset + sizeof(frameHead);
+        if (offset + sizeof(frameHead) + trajectory::payloadSize(frameHead) > dataEnd)
+            throw std::runtime_error("Trajectory truncated - file invalid");
+
+        std::array<std::vector<double>*, 4> cols{&out.posX, &out.posY, &out.velX, &out.velY};
+        out.frame = frameHead.frame;
+        if (frameHead.kind == trajectory::FrameKind::Key) {
+            for (std::size_t c = 0; c != cols.size(); ++c) {
+                cols[c]->resize(n);
+                std::memcpy(cols[c]->data(), payload + c * n * sizeof(double), n * sizeof(double));
+            }
+            return;
+        }
+        if (out.posX.size() != n)
+            throw std::runtime_error("Trajectory delta doesn't match previous frame");
+        auto unpack = [&]<typename T>(T) {
+            for (std::size_t c = 0; c != cols.size(); ++c) {
+                double  quantum = c < 2 ? header.posQuantum : header.velQuantum;
+                double* col     = cols[c]->data();
+                for (std::size_t i = 0; i != n; ++i) {
+                    T q;
+                    std::memcpy(&q, payload + (c * n + i) * sizeof(T), sizeof(T));
+                    col[i] += static_cast<double>(q) * quantum;
+                }
+            }
+        };
+        if (frameHead.width == 1) unpack(std::int8_t{});
+        else if (frameHead.width == 2) unpack(std::int16_t{});
+        else unpack(std::int32_t{});
+    }
+
+  public:
+    explicit TrajectoryReader(const std::filesystem::path& path) : map(path) {
+        header = load<trajectory::FileHeader>(0);
+        if (header.magic != trajectory::Magic)
+            throw std::runtime_error("Not a trajectory - magic invalid");
+        if (header.endian != trajectory::EndianCheck)
+            throw std::runtime_error("Trajectory was written with a different byte order");
+        if (header.version != trajectory::Version)
+            throw std::runtime_error("Unsupported trajectory version " +
+                                     std::to_string(header.version));
+
+        const std::size_t size = map.bytes().size();
+        dataEnd                = size;
+        if (size >= sizeof(trajectory::FileHeader) + sizeof(trajectory::Footer)) {
+            auto footer = load<trajectory::Footer>(size - sizeof(trajectory::Footer));
+            if (footer.magic == trajectory::IndexMagic &&
+                footer.indexOffset >= sizeof(trajectory::FileHeader) &&
+                footer.indexOffset <= size - sizeof(trajectory::Footer) &&
+                footer.keyframeCount == (size - sizeof(trajectory::Footer) - footer.indexOffset) /
+                                            sizeof(trajectory::IndexEntry)) {
+                dataEnd    = footer.indexOffset;
+                frameCount = footer.frameCount;
+                keyframes.resize(footer.keyframeCount);
+                std::memcpy(keyframes.data(), map.bytes().data() + footer.indexOffset,
+                            keyframes.size() * sizeof(trajectory::IndexEntry));
+                return;
+            }
+        }
+        scan();
+    }
+
+    [[nodiscard]] std::size_t frames() const { return frameCount; }
+
+    // calls visit(const TrajectoryFrame&) for frames [first, last) in order, only decoding from the
+    // nearest keyframe before first
+    template <typename F>
+    void replay(std::size_t first, std::size_t last, F&& visit) const {
+        if (first > last || last > frameCount) throw std::out_of_range("Trajectory frame range");
+        if (first == last) return;
+        auto key = std::upper_bound(keyframes.begin(), keyframes.end(), first,
+                                    [](std::size_t f, const auto& e) { return f < e.frame; });
+        if (key == keyframes.begin()) throw std::runtime_error("Trajectory has no keyframe");
+        --key;
+
+        TrajectoryFrame frame;
+        std::size_t     offset = key->offset;
+        for (std::size_t f = key->frame; f != last; ++f) {
+            decode(offset, frame);
+            if (frame.frame != f) throw std::runtime_error("Trajectory frames out of order");
+            if (f >= first) visit(std::as_const(frame));
+            offset += sizeof(trajectory::FrameHeader) +
+                      trajectory::payloadSize(load<trajectory::FrameHeader>(offset));
+        }
+    }
+
+    [[nodiscard]] TrajectoryFrame read(std::size_t frame) const {
+        TrajectoryFrame out;
+        replay(frame, frame + 1, [&](const TrajectoryFrame& f) { out = f; });
+        return out;
+    }
+};
+
+} // namespace persisitance
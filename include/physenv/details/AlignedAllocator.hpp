@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace physenv::details {
+
+// allocates on Align byte boundaries so packed arrays start on a cache line and full width simd
+// loads from the front never split one
+template <typename T, std::size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Align>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>& /*other*/) {}
+
+    [[nodiscard]] T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Align}));
+    }
+    void deallocate(T* p, std::size_t /*n*/) { ::operator delete(p, std::align_val_t{Align}); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Align>& /*other*/) const {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+} // namespace physenv::details
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "Simd.hpp"
+
+namespace physenv::details {
+
+// the kernels quantize values[i] - prev[i] to the nearest whole number of quanta (ties to even),
+// store it in q[i] and advance prev[i] by exactly q[i] * quantum so prev tracks what a decoder
+// will reconstruct
+// returns the largest |q| or nan if any delta isn't finite, q is only meaningful if that fits an
+// int32
+
+inline double quantizeDeltasScalar(const double* values, double* prev, std::int32_t* q,
+                                   std::size_t begin, std::size_t end, double quantum) {
+    // adding then subtracting 1.5 * 2^52 rounds to nearest without a libm call
+    constexpr double round      = 6755399441055744.0;
+    constexpr double limit      = std::numeric_limits<std::int32_t>::max();
+    const double     invQuantum = 1.0 / quantum;
+    double           maxAbs     = 0;
+    bool             finite     = true;
+    for (std::size_t i = begin; i != end; ++i) {
+        double d  = ((values[i] - prev[i]) * invQuantum + round) - round;
+        double a  = std::abs(d);
+        prev[i]  += d * quantum;
+        q[i]      = static_cast<std::int32_t>(a <= limit ? d : 0);
+        maxAbs    = std::max(maxAbs, a);
+        finite   &= a <= std::numeric_limits<double>::max();
+    }
+    return finite ? maxAbs : std::numeric_limits<double>::quiet_NaN();
+}
+
+#ifdef PHYSENV_X86_SIMD
+__attribute__((target("avx2"))) inline double
+quantizeDeltasAvx2(const double* values, double* prev, std::int32_t* q, std::size_t begin,
+                   std::size_t end, double quantum) {
+    const __m256d step       = _mm256_set1_pd(quantum);
+    const __m256d invQuantum = _mm256_set1_pd(1.0 / quantum);
+    const __m256d sign       = _mm256_set1_pd(-0.0);
+    __m256d       maxAbs     = _mm256_setzero_pd();
+    __m256d       unordered  = _mm256_setzero_pd();
+    std::size_t   i          = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d p = _mm256_loadu_pd(prev + i);
+        __m256d d = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(values + i), p), invQuantum);
+        d         = _mm256_round_pd(d, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_pd(prev + i, _mm256_add_pd(p, _mm256_mul_pd(d, step)));
+        // out of range converts to int32 min, the returned max flags that
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(q + i), _mm256_cvtpd_epi32(d));
+        maxAbs    = _mm256_max_pd(maxAbs, _mm256_andnot_pd(sign, d));
+        unordered = _mm256_or_pd(unordered, _mm256_cmp_pd(d, d, _CMP_UNORD_Q));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, maxAbs);
+    double tail = quantizeDeltasScalar(values, prev, q, i, end, quantum);
+    if (_mm256_movemask_pd(unordered) != 0 || tail != tail)
+        return std::numeric_limits<double>::quiet_NaN();
+    return std::max({lanes[0], lanes[1], lanes[2], lanes[3], tail});
+}
+#endif
+
+// picks the widest kernel allowed by simdLevel(), avx512 uses the avx2 path
+inline double quantizeDeltas(const double* values, double* prev, std::int32_t* q,
+                             std::size_t begin, std::size_t end, double quantum) {
+#ifdef PHYSENV_X86_SIMD
+    if (simdLevel() != SimdLevel::Scalar)
+        return quantizeDeltasAvx2(values, prev, q, begin, end, quantum);
+#endif
+    return quantizeDeltasScalar(values, prev, q, begin, end, quantum);
+}
+
+// copies q into the narrower out, every q must fit
+template <typename T>
+inline void narrowScalar(const std::int32_t* q, T* out, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i != end; ++i) out[i] = static_cast<T>(q[i]);
+}
+
+#ifdef PHYSENV_X86_SIMD
+// packs work within 128 bit lanes, the permute puts the groups of 4 back in order
+__attribute__((target("avx2"))) inline void narrowAvx2(const std::int32_t* q, std::int16_t* out,
+                                                       std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + i + 8));
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0b11011000);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+    }
+    narrowScalar(q, out, i, end);
+}
+
+__attribute__((target("avx2"))) inline void narrowAvx2(const std::int32_t* q, std::int8_t* out,
+                                                       std::size_t begin, std::size_t end) {
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    std::size_t   i     = begin;
+    for (; i + 32 <= end; i += 32) {
+        const __m256i* in = reinterpret_cast<const __m256i*>(q + i);
+        __m256i ab = _mm256_packs_epi32(_mm256_loadu_si256(in), _mm256_loadu_si256(in + 1));
+        __m256i cd = _mm256_packs_epi32(_mm256_loadu_si256(in + 2), _mm256_loadu_si256(in + 3));
+        __m256i r  = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(ab, cd), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+    }
+    narrowScalar(q, out, i, end);
+}
+#endif
+
+template <typename T>
+inline void narrow(const std::int32_t* q, T* out, std::size_t begin, std::size_t end) {
+#ifdef PHYSENV_X86_SIMD
+    if (simdLevel() != SimdLevel::Scalar) return narrowAvx2(q, out, begin, end);
+#endif
+    narrowScalar(q, out, begin, end);
+}
+
+} // namespace physenv::details
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "Vector2.hpp"
+
+namespace physenv::details {
+
+// acceleration structure over the edges of one polygon, edge i runs from (x[i], y[i]) to
+// (x[i + 1], y[i + 1])
+// - x slabs, every edge is listed in each slab its x range overlaps (compressed rows like
+//   UniformGrid) so an upward ray cast only has to test the edges of one slab
+// - a bvh over runs of consecutive edges, outlines are spatially coherent in order so the runs
+//   make tight boxes without any sorting, searched branch and bound for the closest edge
+template <typename T>
+class EdgeIndex {
+  private:
+    static constexpr std::size_t leafSize = 8; // edges per bvh leaf
+
+    struct Box {
+        T minX, minY, maxX, maxY;
+
+        [[nodiscard]] T sqDist(const Vector2<T>& pos) const {
+            T dx = std::max({minX - pos.x, T(0), pos.x - maxX});
+            T dy = std::max({minY - pos.y, T(0), pos.y - maxY});
+            return dx * dx + dy * dy;
+        }
+    };
+
+    std::size_t              edges_ = 0;
+    T                        originX_{};
+    T                        slabWidth_ = 1;
+    std::vector<std::size_t> slabStart_{}; // slabs + 1 offsets into slabEdges_
+    std::vector<std::size_t> slabEdges_{};
+    std::vector<Box>         nodes_{}; // implicit complete tree, children of k are 2k + 1, 2k + 2
+    std::size_t              leaves_ = 0; // a power of two, the last nodes_ are the leaves
+
+    [[nodiscard]] std::size_t slabCount() const { return slabStart_.size() - 1; }
+    [[nodiscard]] std::size_t clampSlab(T x) const {
+        return static_cast<std::size_t>(std::clamp(std::floor((x - originX_) / slabWidth_), T(0),
+                                                   static_cast<T>(slabCount() - 1)));
+    }
+
+  public:
+    void build(std::span<const T> x, std::span<const T> y, std::size_t edges) {
+        clear();
+        if (edges == 0) return;
+        edges_ = edges;
+
+        // slabs, about one per edge
+        auto [minX, maxX] = std::ranges::minmax_element(x.first(edges));
+        originX_          = *minX;
+        slabWidth_        = std::max((*maxX - *minX) / static_cast<T>(edges), T(1e-12));
+        slabStart_.assign(edges + 1, 0);
+        auto forSlabs = [&](std::size_t i, auto&& fn) {
+            std::size_t last = clampSlab(std::max(x[i], x[i + 1]));
+            for (std::size_t s = clampSlab(std::min(x[i], x[i + 1])); s <= last; ++s) fn(s);
+        };
+        for (std::size_t i = 0; i != edges; ++i)
+            forSlabs(i, [&](std::size_t s) { ++slabStart_[s + 1]; });
+        for (std::size_t s = 0; s != slabCount(); ++s) slabStart_[s + 1] += slabStart_[s];
+        slabEdges_.resize(slabStart_.back());
+        std::vector<std::size_t> fill(slabStart_.begin(), slabStart_.end() - 1);
+        for (std::size_t i = 0; i != edges; ++i)
+            forSlabs(i, [&](std::size_t s) { slabEdges_[fill[s]++] = i; });
+
+        // bvh, leaves first then each parent is the union of its children
+        leaves_ = std::bit_ceil((edges + leafSize - 1) / leafSize);
+        const T inf = std::numeric_limits<T>::infinity();
+        nodes_.assign(2 * leaves_ - 1, Box{inf, inf, -inf, -inf}); // empty boxes are never near
+        for (std::size_t i = 0; i != edges; ++i) {
+            Box& leaf = nodes_[leaves_ - 1 + i / leafSize];
+            leaf.minX = std::min({leaf.minX, x[i], x[i + 1]});
+            leaf.minY = std::min({leaf.minY, y[i], y[i + 1]});
+            leaf.maxX = std::max({leaf.maxX, x[i], x[i + 1]});
+            leaf.maxY = std::max({leaf.maxY, y[i], y[i + 1]});
+        }
+        for (std::size_t k = leaves_ - 1; k-- != 0;) {
+            const Box& a = nodes_[2 * k + 1];
+            const Box& b = nodes_[2 * k + 2];
+            nodes_[k]    = {std::min(a.minX, b.minX), std::min(a.minY, b.minY),
+                            std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return edges_ == 0; }
+
+    void clear() {
+        edges_  = 0;
+        leaves_ = 0;
+        slabStart_.clear();
+        slabEdges_.clear();
+        nodes_.clear();
+    }
+
+    // edges whose x range overlaps the slab containing x, which includes every edge an upward ray
+    // from x can cross
+    [[nodiscard]] std::span<const std::size_t> slab(T x) const {
+        if (empty()) return {};
+        std::size_t s = clampSlab(x);
+        return std::span(slabEdges_).subspan(slabStart_[s], slabStart_[s + 1] - slabStart_[s]);
+    }
+
+    // sqDist(i) gives the squared distance from pos to edge i, it must be at least that to the
+    // edge's bounding box (true of the distance to the segment)
+    // returns {index, squared distance} or {-1, inf} if empty
+    template <typename F>
+    std::pair<std::size_t, T> nearest(const Vector2<T>& pos, F&& sqDist) const {
+        std::pair<std::size_t, T> best{static_cast<std::size_t>(-1),
+                                       std::numeric_limits<T>::infinity()};
+        if (empty()) return best;
+        std::array<std::size_t, 64> stack{}; // deeper than any tree that fits in memory
+        std::size_t                 top = 1;
+        while (top != 0) {
+            std::size_t k = stack[--top];
+            if (nodes_[k].sqDist(pos) >= best.second) continue;
+            if (k >= leaves_ - 1) { // leaf
+                std::size_t first = (k - (leaves_ - 1)) * leafSize;
+                std::size_t last  = std::min(edges_, first + leafSize);
+                for (std::size_t i = first; i < last; ++i) {
+                    T d = sqDist(i);
+                    if (d < best.second) best = {i, d};
+                }
+                continue;
+            }
+            std::size_t nearer  = 2 * k + 1;
+            std::size_t further = 2 * k + 2;
+            if (nodes_[further].sqDist(pos) < nodes_[nearer].sqDist(pos)) {
+                std::swap(nearer, further);
+            }
+            stack[top++] = further;
+            stack[top++] = nearer; // searched first
+        }
+        return best;
+    }
+};
+
+} // namespace physenv::details
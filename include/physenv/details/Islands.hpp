@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace physenv::details {
+
+// connected components of the points joined by springs, labelled 0 to count() - 1 in order of
+// their lowest point
+class Islands {
+  private:
+    std::vector<std::size_t> parent_{};
+
+    std::size_t root(std::size_t i) {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]]; // path halving
+            i          = parent_[i];
+        }
+        return i;
+    }
+
+  public:
+    std::vector<std::size_t> of{};    // island of each dense point index
+    std::vector<std::size_t> sizes{}; // points per island
+
+    // ends(s) returns the dense point indicies (p1, p2) of spring s
+    template <typename F>
+    void build(std::size_t points, std::size_t springs, F&& ends) {
+        parent_.resize(points);
+        std::iota(parent_.begin(), parent_.end(), std::size_t{0});
+        for (std::size_t s = 0; s != springs; ++s) {
+            auto [a, b] = ends(s);
+            a           = root(a);
+            b           = root(b);
+            if (a != b) parent_[std::max(a, b)] = std::min(a, b); // lowest index is the root
+        }
+
+        // roots come before their members so one pass labels everything
+        of.resize(points);
+        sizes.clear();
+        for (std::size_t i = 0; i != points; ++i) {
+            std::size_t r = root(i);
+            if (r == i) {
+                of[i] = sizes.size();
+                sizes.push_back(0);
+            } else {
+                of[i] = of[r];
+            }
+            ++sizes[of[i]];
+        }
+    }
+
+    [[nodiscard]] std::size_t count() const { return sizes.size(); }
+
+    void clear() {
+        parent_.clear();
+        of.clear();
+        sizes.clear();
+    }
+};
+
+} // namespace physenv::details
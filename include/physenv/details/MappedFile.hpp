@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace physenv::details {
+
+// read only memory mapping of a whole file
+class MappedFile {
+  private:
+    const std::byte* data_ = nullptr;
+    std::size_t      size_ = 0;
+#ifdef _WIN32
+    HANDLE file_    = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+
+  public:
+    explicit MappedFile(const std::filesystem::path& path) {
+        auto fail = [&] {
+            throw std::runtime_error("failed to map file \"" + path.string() + '"');
+        };
+#ifdef _WIN32
+        file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) fail();
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size)) {
+            CloseHandle(file_);
+            fail();
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ != nullptr) {
+            data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (data_ == nullptr) {
+            if (mapping_ != nullptr) CloseHandle(mapping_);
+            CloseHandle(file_);
+            fail();
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) fail();
+        struct stat info {};
+        if (::fstat(fd, &info) == -1) {
+            ::close(fd);
+            fail();
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ != 0) {
+            void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                ::close(fd);
+                fail();
+            }
+            ::madvise(map, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const std::byte*>(map);
+        }
+        ::close(fd); // the mapping keeps the file alive
+#endif
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_ != nullptr) ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const { return {data_, size_}; }
+};
+
+} // namespace physenv::details
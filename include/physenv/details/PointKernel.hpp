@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Simd.hpp"
+
+namespace physenv::details {
+
+// mutable view of the point arrays the integrator works on
+template <typename T>
+struct PointState {
+    T*                  posX;
+    T*                  posY;
+    T*                  velX;
+    T*                  velY;
+    T*                  forceX;
+    T*                  forceY;
+    const T*            invMass;
+    const std::uint8_t* fixed;
+};
+
+// the kernels integrate points [begin, end) the same way as Point::update and reset their forces
+// fixed points are masked out rather than branched on and every path gives identical results
+
+template <typename T>
+inline void integrateScalar(const PointState<T>& p, std::size_t begin, std::size_t end,
+                            T deltaTime, T gravity) {
+    for (std::size_t i = begin; i != end; ++i) {
+        bool free   = p.fixed[i] == 0; // the ternaries below compile to selects
+        T    velX   = p.velX[i] + p.forceX[i] * p.invMass[i] * deltaTime;
+        T    velY   = p.velY[i] + (p.forceY[i] * p.invMass[i] - gravity) * deltaTime;
+        p.velX[i]   = free ? velX : p.velX[i];
+        p.velY[i]   = free ? velY : p.velY[i];
+        T    posX   = p.posX[i] + p.velX[i] * deltaTime;
+        T    posY   = p.posY[i] + p.velY[i] * deltaTime;
+        p.posX[i]   = free ? posX : p.posX[i];
+        p.posY[i]   = free ? posY : p.posY[i];
+        p.forceX[i] = 0;
+        p.forceY[i] = 0;
+    }
+}
+
+#ifdef PHYSENV_X86_SIMD
+__attribute__((target("avx2"))) inline void integrateAvx2(const PointState<double>& p,
+                                                          std::size_t begin, std::size_t end,
+                                                          double deltaTime, double gravity) {
+    const __m256d dt   = _mm256_set1_pd(deltaTime);
+    const __m256d g    = _mm256_set1_pd(gravity);
+    const __m256d zero = _mm256_setzero_pd();
+    std::size_t   i    = begin;
+    for (; i + 4 <= end; i += 4) {
+        std::int32_t fixedBytes;
+        std::memcpy(&fixedBytes, p.fixed + i, sizeof(fixedBytes));
+        __m256i fixed64 = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(fixedBytes));
+        __m256d isFixed =
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(fixed64, _mm256_setzero_si256()));
+
+        __m256d invMass = _mm256_loadu_pd(p.invMass + i);
+        __m256d velX    = _mm256_loadu_pd(p.velX + i);
+        __m256d velY    = _mm256_loadu_pd(p.velY + i);
+        __m256d posX    = _mm256_loadu_pd(p.posX + i);
+        __m256d posY    = _mm256_loadu_pd(p.posY + i);
+        __m256d accX    = _mm256_mul_pd(_mm256_loadu_pd(p.forceX + i), invMass);
+        __m256d accY    = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(p.forceY + i), invMass), g);
+        velX = _mm256_blendv_pd(_mm256_add_pd(velX, _mm256_mul_pd(accX, dt)), velX, isFixed);
+        velY = _mm256_blendv_pd(_mm256_add_pd(velY, _mm256_mul_pd(accY, dt)), velY, isFixed);
+        posX = _mm256_blendv_pd(_mm256_add_pd(posX, _mm256_mul_pd(velX, dt)), posX, isFixed);
+        posY = _mm256_blendv_pd(_mm256_add_pd(posY, _mm256_mul_pd(velY, dt)), posY, isFixed);
+
+        _mm256_storeu_pd(p.velX + i, velX);
+        _mm256_storeu_pd(p.velY + i, velY);
+        _mm256_storeu_pd(p.posX + i, posX);
+        _mm256_storeu_pd(p.posY + i, posY);
+        _mm256_storeu_pd(p.forceX + i, zero);
+        _mm256_storeu_pd(p.forceY + i, zero);
+    }
+    integrateScalar(p, i, end, deltaTime, gravity);
+}
+
+__attribute__((target("avx512f"))) inline void integrateAvx512(const PointState<double>& p,
+                                                               std::size_t begin, std::size_t end,
+                                                               double deltaTime, double gravity) {
+    const __m512d dt   = _mm512_set1_pd(deltaTime);
+    const __m512d g    = _mm512_set1_pd(gravity);
+    const __m512d zero = _mm512_setzero_pd();
+    std::size_t   i    = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m128i  fixed8  = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p.fixed + i));
+        __m512i  fixed64 = _mm512_maskz_cvtepu8_epi64(0xFF, fixed8); // masked to quiet gcc
+        __mmask8 isFree  = _mm512_testn_epi64_mask(fixed64, fixed64);
+
+        __m512d invMass = _mm512_loadu_pd(p.invMass + i);
+        __m512d velX    = _mm512_loadu_pd(p.velX + i);
+        __m512d velY    = _mm512_loadu_pd(p.velY + i);
+        __m512d posX    = _mm512_loadu_pd(p.posX + i);
+        __m512d posY    = _mm512_loadu_pd(p.posY + i);
+        __m512d accX    = _mm512_mul_pd(_mm512_loadu_pd(p.forceX + i), invMass);
+        __m512d accY    = _mm512_sub_pd(_mm512_mul_pd(_mm512_loadu_pd(p.forceY + i), invMass), g);
+        velX = _mm512_mask_add_pd(velX, isFree, velX, _mm512_mul_pd(accX, dt));
+        velY = _mm512_mask_add_pd(velY, isFree, velY, _mm512_mul_pd(accY, dt));
+        posX = _mm512_mask_add_pd(posX, isFree, posX, _mm512_mul_pd(velX, dt));
+        posY = _mm512_mask_add_pd(posY, isFree, posY, _mm512_mul_pd(velY, dt));
+
+        _mm512_storeu_pd(p.velX + i, velX);
+        _mm512_storeu_pd(p.velY + i, velY);
+        _mm512_storeu_pd(p.posX + i, posX);
+        _mm512_storeu_pd(p.posY + i, posY);
+        _mm512_storeu_pd(p.forceX + i, zero);
+        _mm512_storeu_pd(p.forceY + i, zero);
+    }
+    integrateScalar(p, i, end, deltaTime, gravity);
+}
+
+// float has twice the lanes, avx512 uses this path too
+__attribute__((target("avx2"))) inline void integrateAvx2(const PointState<float>& p,
+                                                          std::size_t begin, std::size_t end,
+                                                          float deltaTime, float gravity) {
+    const __m256 dt   = _mm256_set1_ps(deltaTime);
+    const __m256 g    = _mm256_set1_ps(gravity);
+    const __m256 zero = _mm256_setzero_ps();
+    std::size_t  i    = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m128i fixed8  = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p.fixed + i));
+        __m256i fixed32 = _mm256_cvtepu8_epi32(fixed8);
+        __m256  isFixed =
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(fixed32, _mm256_setzero_si256()));
+
+        __m256 invMass = _mm256_loadu_ps(p.invMass + i);
+        __m256 velX    = _mm256_loadu_ps(p.velX + i);
+        __m256 velY    = _mm256_loadu_ps(p.velY + i);
+        __m256 posX    = _mm256_loadu_ps(p.posX + i);
+        __m256 posY    = _mm256_loadu_ps(p.posY + i);
+        __m256 accX    = _mm256_mul_ps(_mm256_loadu_ps(p.forceX + i), invMass);
+        __m256 accY    = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(p.forceY + i), invMass), g);
+        velX = _mm256_blendv_ps(_mm256_add_ps(velX, _mm256_mul_ps(accX, dt)), velX, isFixed);
+        velY = _mm256_blendv_ps(_mm256_add_ps(velY, _mm256_mul_ps(accY, dt)), velY, isFixed);
+        posX = _mm256_blendv_ps(_mm256_add_ps(posX, _mm256_mul_ps(velX, dt)), posX, isFixed);
+        posY = _mm256_blendv_ps(_mm256_add_ps(posY, _mm256_mul_ps(velY, dt)), posY, isFixed);
+
+        _mm256_storeu_ps(p.velX + i, velX);
+        _mm256_storeu_ps(p.velY + i, velY);
+        _mm256_storeu_ps(p.posX + i, posX);
+        _mm256_storeu_ps(p.posY + i, posY);
+        _mm256_storeu_ps(p.forceX + i, zero);
+        _mm256_storeu_ps(p.forceY + i, zero);
+    }
+    integrateScalar(p, i, end, deltaTime, gravity);
+}
+#endif
+
+// picks the widest kernel allowed by simdLevel()
+template <typename T>
+inline void integrate(const PointState<T>& p, std::size_t begin, std::size_t end, T deltaTime,
+                      T gravity) {
+#ifdef PHYSENV_X86_SIMD
+    switch (simdLevel()) {
+    case SimdLevel::Avx512:
+        if constexpr (std::is_same_v<T, double>) {
+            return integrateAvx512(p, begin, end, deltaTime, gravity);
+        }
+        [[fallthrough]];
+    case SimdLevel::Avx2:
+        return integrateAvx2(p, begin, end, deltaTime, gravity);
+    case SimdLevel::Scalar:
+        break;
+    }
+#endif
+    integrateScalar(p, begin, end, deltaTime, gravity);
+}
+
+} // namespace physenv::details
@@ -2,8 +2,6 @@
 
 #include <vector>
 
-// TODO maybe move out of physenv or not if runge kutta
-
 namespace physenv::details {
 
 template <typename T>
@@ -28,7 +26,8 @@ class RingBuffer {
     }
 
     void reset() {
-        pos = 0;
+        size = 0;
+        pos  = 0;
         v.clear();
     }
 };
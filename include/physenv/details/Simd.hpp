@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PHYSENV_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace physenv::details {
+
+enum class SimdLevel { Scalar, Avx2, Avx512 };
+
+// widest instruction set the running cpu supports
+inline SimdLevel detectSimd() {
+#ifdef PHYSENV_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+inline SimdLevel simdLevel();
+inline SimdLevel setSimdLevel(SimdLevel level);
+
+// holds the level the batch kernels dispatch on, only reachable through the two functions below so
+// it can't be raised past what the cpu supports
+class SimdState {
+    static SimdLevel& level() {
+        static SimdLevel current = detectSimd();
+        return current;
+    }
+    friend SimdLevel simdLevel();
+    friend SimdLevel setSimdLevel(SimdLevel level);
+};
+
+// level the batch kernels dispatch on, the widest the cpu supports unless lowered
+inline SimdLevel simdLevel() { return SimdState::level(); }
+
+// forces a narrower path, clamped to detectSimd() so asking for more than the cpu has is safe
+// returns the level now in use
+inline SimdLevel setSimdLevel(SimdLevel level) {
+    return SimdState::level() = std::min(level, detectSimd());
+}
+
+} // namespace physenv::details
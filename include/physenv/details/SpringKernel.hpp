@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "Simd.hpp"
+
+namespace physenv::details {
+
+// read only view of the point arrays the spring kernel needs
+template <typename T>
+struct PointArrays {
+    const T* posX;
+    const T* posY;
+    const T* velX;
+    const T* velY;
+};
+
+// springs copied out into structure of arrays form with their points resolved to dense indicies
+template <typename T>
+struct SpringArrays {
+    std::vector<std::size_t> p1{};
+    std::vector<std::size_t> p2{};
+    std::vector<T>           springConst{};
+    std::vector<T>           dampFact{};
+    std::vector<T>           naturalLength{};
+
+    void resize(std::size_t n) {
+        p1.resize(n);
+        p2.resize(n);
+        springConst.resize(n);
+        dampFact.resize(n);
+        naturalLength.resize(n);
+    }
+};
+
+// the kernels write the force on p1 of spring s (p2 gets the negative) to forceX/Y[s - begin]
+// all match Spring::forceCalc, the vector ones use sqrt instead of hypot
+
+template <typename T>
+inline void springForcesScalar(const PointArrays<T>& pts, const SpringArrays<T>& springs,
+                               std::size_t begin, std::size_t end, T* forceX, T* forceY) {
+    for (std::size_t s = begin; s != end; ++s) {
+        std::size_t i1  = springs.p1[s];
+        std::size_t i2  = springs.p2[s];
+        T           dx  = pts.posX[i1] - pts.posX[i2];
+        T           dy  = pts.posY[i1] - pts.posY[i2];
+        T           mag = std::hypot(dx, dy);
+        T           fx  = 0;
+        T           fy  = 0;
+        if (mag >= T(1E-30)) { // prevent 0 length spring exploding sim
+            T ux    = dx / mag;
+            T uy    = dy / mag;
+            T rvx   = pts.velX[i2] - pts.velX[i1];
+            T rvy   = pts.velY[i2] - pts.velY[i1];
+            T sprf  = -springs.springConst[s] * (mag - springs.naturalLength[s]);
+            T dampf = (ux * rvx + uy * rvy) * springs.dampFact[s];
+            fx      = (sprf + dampf) * ux;
+            fy      = (sprf + dampf) * uy;
+        }
+        forceX[s - begin] = fx;
+        forceY[s - begin] = fy;
+    }
+}
+
+#ifdef PHYSENV_X86_SIMD
+__attribute__((target("avx2"))) inline void
+springForcesAvx2(const PointArrays<double>& pts, const SpringArrays<double>& springs,
+                 std::size_t begin, std::size_t end, double* forceX, double* forceY) {
+    const __m256d minMag = _mm256_set1_pd(1E-30);
+    std::size_t   s      = begin;
+    for (; s + 4 <= end; s += 4) {
+        __m256i i1  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.p1[s]));
+        __m256i i2  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&springs.p2[s]));
+        __m256d dx  = _mm256_sub_pd(_mm256_i64gather_pd(pts.posX, i1, 8),
+                                    _mm256_i64gather_pd(pts.posX, i2, 8));
+        __m256d dy  = _mm256_sub_pd(_mm256_i64gather_pd(pts.posY, i1, 8),
+                                    _mm256_i64gather_pd(pts.posY, i2, 8));
+        __m256d rvx = _mm256_sub_pd(_mm256_i64gather_pd(pts.velX, i2, 8),
+                                    _mm256_i64gather_pd(pts.velX, i1, 8));
+        __m256d rvy = _mm256_sub_pd(_mm256_i64gather_pd(pts.velY, i2, 8),
+                                    _mm256_i64gather_pd(pts.velY, i1, 8));
+
+        __m256d sqMag = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        __m256d mag   = _mm256_sqrt_pd(sqMag);
+        __m256d valid = _mm256_cmp_pd(mag, minMag, _CMP_GE_OQ);
+        __m256d ux    = _mm256_div_pd(dx, mag);
+        __m256d uy    = _mm256_div_pd(dy, mag);
+        __m256d ext   = _mm256_sub_pd(_mm256_loadu_pd(&springs.naturalLength[s]), mag); // -ext
+        __m256d sprf  = _mm256_mul_pd(_mm256_loadu_pd(&springs.springConst[s]), ext);
+        __m256d relv  = _mm256_add_pd(_mm256_mul_pd(ux, rvx), _mm256_mul_pd(uy, rvy));
+        __m256d dampf = _mm256_mul_pd(relv, _mm256_loadu_pd(&springs.dampFact[s]));
+        __m256d f     = _mm256_add_pd(sprf, dampf);
+        // masked after the multiply as ux and uy are nan for a 0 length spring
+        _mm256_storeu_pd(&forceX[s - begin], _mm256_and_pd(valid, _mm256_mul_pd(f, ux)));
+        _mm256_storeu_pd(&forceY[s - begin], _mm256_and_pd(valid, _mm256_mul_pd(f, uy)));
+    }
+    springForcesScalar(pts, springs, s, end, forceX + (s - begin), forceY + (s - begin));
+}
+
+// the indicies stay 64 bit so 8 floats take two gathers
+__attribute__((target("avx2"))) inline __m256 gather8(const float* base,
+                                                      const std::size_t* index) {
+    const __m256i* at = reinterpret_cast<const __m256i*>(index);
+    __m128         lo = _mm256_i64gather_ps(base, _mm256_loadu_si256(at), 4);
+    __m128         hi = _mm256_i64gather_ps(base, _mm256_loadu_si256(at + 1), 4);
+    return _mm256_set_m128(hi, lo);
+}
+
+// float has twice the lanes, avx512 uses this path too
+__attribute__((target("avx2"))) inline void
+springForcesAvx2(const PointArrays<float>& pts, const SpringArrays<float>& springs,
+                 std::size_t begin, std::size_t end, float* forceX, float* forceY) {
+    const __m256 minMag = _mm256_set1_ps(1E-30F);
+    std::size_t  s      = begin;
+    for (; s + 8 <= end; s += 8) {
+        const std::size_t* i1  = &springs.p1[s];
+        const std::size_t* i2  = &springs.p2[s];
+        __m256             dx  = _mm256_sub_ps(gather8(pts.posX, i1), gather8(pts.posX, i2));
+        __m256             dy  = _mm256_sub_ps(gather8(pts.posY, i1), gather8(pts.posY, i2));
+        __m256             rvx = _mm256_sub_ps(gather8(pts.velX, i2), gather8(pts.velX, i1));
+        __m256             rvy = _mm256_sub_ps(gather8(pts.velY, i2), gather8(pts.velY, i1));
+
+        __m256 sqMag = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 mag   = _mm256_sqrt_ps(sqMag);
+        __m256 valid = _mm256_cmp_ps(mag, minMag, _CMP_GE_OQ);
+        __m256 ux    = _mm256_div_ps(dx, mag);
+        __m256 uy    = _mm256_div_ps(dy, mag);
+        __m256 ext   = _mm256_sub_ps(_mm256_loadu_ps(&springs.naturalLength[s]), mag); // -ext
+        __m256 sprf  = _mm256_mul_ps(_mm256_loadu_ps(&springs.springConst[s]), ext);
+        __m256 relv  = _mm256_add_ps(_mm256_mul_ps(ux, rvx), _mm256_mul_ps(uy, rvy));
+        __m256 dampf = _mm256_mul_ps(relv, _mm256_loadu_ps(&springs.dampFact[s]));
+        __m256 f     = _mm256_add_ps(sprf, dampf);
+        _mm256_storeu_ps(&forceX[s - begin], _mm256_and_ps(valid, _mm256_mul_ps(f, ux)));
+        _mm256_storeu_ps(&forceY[s - begin], _mm256_and_ps(valid, _mm256_mul_ps(f, uy)));
+    }
+    springForcesScalar(pts, springs, s, end, forceX + (s - begin), forceY + (s - begin));
+}
+
+// masked forms as the plain ones trip gcc's maybe-uninitialized on their undefined source
+// without optimisation gcc's macro form of the intrinsic casts the mask through char
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+__attribute__((target("avx512f"))) inline __m512d gather8(const double* base, __m512i index) {
+    return _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, index, base, 8);
+}
+#pragma GCC diagnostic pop
+
+__attribute__((target("avx512f"))) inline void
+springForcesAvx512(const PointArrays<double>& pts, const SpringArrays<double>& springs,
+                   std::size_t begin, std::size_t end, double* forceX, double* forceY) {
+    const __m512d minMag = _mm512_set1_pd(1E-30);
+    std::size_t   s      = begin;
+    for (; s + 8 <= end; s += 8) {
+        __m512i i1  = _mm512_loadu_si512(&springs.p1[s]);
+        __m512i i2  = _mm512_loadu_si512(&springs.p2[s]);
+        __m512d dx  = _mm512_sub_pd(gather8(pts.posX, i1), gather8(pts.posX, i2));
+        __m512d dy  = _mm512_sub_pd(gather8(pts.posY, i1), gather8(pts.posY, i2));
+        __m512d rvx = _mm512_sub_pd(gather8(pts.velX, i2), gather8(pts.velX, i1));
+        __m512d rvy = _mm512_sub_pd(gather8(pts.velY, i2), gather8(pts.velY, i1));
+
+        __m512d  sqMag = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+        __m512d  mag   = _mm512_maskz_sqrt_pd(0xFF, sqMag);
+        __mmask8 valid = _mm512_cmp_pd_mask(mag, minMag, _CMP_GE_OQ);
+        __m512d  ux    = _mm512_div_pd(dx, mag);
+        __m512d  uy    = _mm512_div_pd(dy, mag);
+        __m512d  ext   = _mm512_sub_pd(_mm512_loadu_pd(&springs.naturalLength[s]), mag); // -ext
+        __m512d  sprf  = _mm512_mul_pd(_mm512_loadu_pd(&springs.springConst[s]), ext);
+        __m512d  relv  = _mm512_add_pd(_mm512_mul_pd(ux, rvx), _mm512_mul_pd(uy, rvy));
+        __m512d  dampf = _mm512_mul_pd(relv, _mm512_loadu_pd(&springs.dampFact[s]));
+        __m512d  f     = _mm512_add_pd(sprf, dampf);
+        _mm512_storeu_pd(&forceX[s - begin], _mm512_maskz_mul_pd(valid, f, ux));
+        _mm512_storeu_pd(&forceY[s - begin], _mm512_maskz_mul_pd(valid, f, uy));
+    }
+    springForcesScalar(pts, springs, s, end, forceX + (s - begin), forceY + (s - begin));
+}
+#endif
+
+// picks the widest kernel allowed by simdLevel()
+template <typename T>
+inline void springForces(const PointArrays<T>& pts, const SpringArrays<T>& springs,
+                         std::size_t begin, std::size_t end, T* forceX, T* forceY) {
+#ifdef PHYSENV_X86_SIMD
+    switch (simdLevel()) {
+    case SimdLevel::Avx512:
+        if constexpr (std::is_same_v<T, double>) {
+            return springForcesAvx512(pts, springs, begin, end, forceX, forceY);
+        }
+        [[fallthrough]];
+    case SimdLevel::Avx2:
+        return springForcesAvx2(pts, springs, begin, end, forceX, forceY);
+    case SimdLevel::Scalar:
+        break;
+    }
+#endif
+    springForcesScalar(pts, springs, begin, end, forceX, forceY);
+}
+
+} // namespace physenv::details
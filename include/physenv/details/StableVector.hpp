@@ -1,12 +1,19 @@
 #pragma once
 
-#include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 
 namespace physenv {
 
+template <typename>
+class BasicPointStore;
+
 namespace details {
 
 struct DefRefTag;
@@ -17,6 +24,9 @@ class PepperedVector;
 template <typename, typename>
 class CompactMap;
 
+template <typename, typename>
+class SlotMap;
+
 template <typename T, typename RefTag = DefRefTag>
 struct Ref {
   private:
@@ -46,6 +56,9 @@ struct Ref {
     }
     friend class PepperedVector<T, RefTag>;
     friend class CompactMap<T, RefTag>;
+    friend class SlotMap<T, RefTag>;
+    template <typename>
+    friend class ::physenv::BasicPointStore;
     friend class std::hash<Ref<T, RefTag>>;
 
   public:
@@ -55,6 +68,22 @@ struct Ref {
     bool operator==(const Ref& obj) const { return id == obj.id; }
 };
 
+// compacts after a bulk erase - survivors from the back are moved into the holes so only
+// [0, n - removed) is kept, calls move(from, to) for each and is O(n) however many were removed
+template <typename Move>
+std::size_t fillHoles(const std::vector<std::uint8_t>& doomed, std::size_t removed, Move&& move) {
+    std::size_t keep = doomed.size() - removed;
+    std::size_t back = doomed.size();
+    for (std::size_t hole = 0; hole != keep; ++hole) {
+        if (doomed[hole] == 0) continue;
+        do {
+            --back;
+        } while (doomed[back] != 0);
+        move(back, hole);
+    }
+    return keep;
+}
+
 template <typename T, typename RefTag = DefRefTag>
 class PepperedVector {
   private:
@@ -67,8 +96,8 @@ class PepperedVector {
         bool isDeleted;
         Elem elem;
     };
-    std::vector<ElemExists>                                                               vec{};
-    std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<std::size_t>> queue{};
+    std::vector<ElemExists>  vec{};
+    std::vector<std::size_t> holes{}; // min heap of free slots so the lowest is filled first
 
   public:
     // store the return value or you will only be able to retrieve/delete this element through
@@ -76,9 +105,10 @@ class PepperedVector {
     template <typename E>
     Ref insert(E&& elem) { // forwarded
         Ref ind;
-        if (!queue.empty()) { // if hole can be filled
-            ind = Ref(queue.top());
-            queue.pop();
+        if (!holes.empty()) { // if hole can be filled
+            std::pop_heap(holes.begin(), holes.end(), std::greater<>{});
+            ind = Ref(holes.back());
+            holes.pop_back();
             vec[ind.id] = ElemExists{false, Elem{ind, std::forward<E>(elem)}};
         } else { // back
             ind = Ref(vec.size());
@@ -89,16 +119,27 @@ class PepperedVector {
     // deletion does not change underyling array so can delete while iterating
     void erase(const Ref& ind) {
         vec.at(ind.id).isDeleted = true;
-        queue.push(ind.id);
+        holes.push_back(ind.id);
+        std::push_heap(holes.begin(), holes.end(), std::greater<>{});
     }
 
+    // the holes are re-heaped once rather than per element
     template <std::ranges::forward_range R>
         requires std::is_same_v<std::ranges::range_value_t<R>, Ref>
-    void erase(R&& range) { // std::priority_queue::push_range doesn't exist yet :(
-                            // std::ranges::for_each(range, &this->rem);
-        for (auto r: range) {
-            erase(r);
+    void erase(R&& range) {
+        for (const auto& ind: range) {
+            vec.at(ind.id).isDeleted = true;
+            holes.push_back(ind.id);
         }
+        std::make_heap(holes.begin(), holes.end(), std::greater<>{});
+    }
+
+    template <std::ranges::input_range R>
+    std::vector<Ref> insert_range(R&& range) {
+        std::vector<Ref> refs;
+        if constexpr (std::ranges::sized_range<R>) refs.reserve(std::ranges::size(range));
+        for (auto&& elem: range) refs.push_back(insert(std::forward<decltype(elem)>(elem)));
+        return refs;
     }
 
     [[nodiscard]] Elem front() const { return *(this->cbegin()); }
@@ -110,12 +151,12 @@ class PepperedVector {
         return !vec[ind.id].isDeleted;
     }
 
-    [[nodiscard]] std::size_t size() const { return vec.size() - queue.size(); }
+    [[nodiscard]] std::size_t size() const { return vec.size() - holes.size(); }
     [[nodiscard]] bool        empty() const { return size() == 0; }
     void                      reserve(std::size_t n) { vec.reserve(n); }
     void                      clear() { // invalidates all refs previously made by this object
         vec.clear();
-        queue = decltype(queue)();
+        holes.clear();
     }
 
     [[nodiscard]] T&       operator[](const Ref& ind) { return vec[ind.id].elem.obj; }
@@ -139,7 +180,7 @@ class PepperedVector {
         Iterator& operator++() { // Prefix increment
             do {
                 ++it;
-            } while (it->isDeleted && it != (*vec).vec.cend());
+            } while (it != (*vec).vec.cend() && it->isDeleted);
             return *this;
         }
 
@@ -186,7 +227,7 @@ class PepperedVector {
         ConstIterator& operator++() { // Prefix increment
             do {
                 ++it;
-            } while (it->isDeleted && it != (*vec).vec.cend());
+            } while (it != (*vec).vec.cend() && it->isDeleted);
             return *this;
         }
 
@@ -290,19 +331,37 @@ class CompactMap {
         vec.pop_back();
     }
     // deletion changes underyling array and therefore invalidates iterators-pointers
+    // one compaction pass, O(n + k) and only the moved elements touch the map
     template <std::ranges::forward_range R>
         requires std::is_same_v<std::ranges::range_value_t<R>, Ref>
     void erase(R&& range) {
-        auto back = --vec.end();
-        // TODO figure out for each here cause idk ^^ that breaks it
-        for (auto ind: range) {
-            auto delIndex     = map.at(ind.id);
-            map[back->ind.id] = delIndex;
-            vec[delIndex]     = *back;
-            --back;
-            map.erase(ind.id);
+        std::vector<std::uint8_t> doomed(vec.size());
+        std::size_t               removed = 0;
+        for (const auto& ind: range) { // all looked up before anything changes
+            auto delIndex = map.at(ind.id);
+            if (doomed[delIndex] == 0) ++removed;
+            doomed[delIndex] = 1;
         }
-        vec.erase(++back, vec.end());
+        for (std::size_t i = 0; i != vec.size(); ++i) {
+            if (doomed[i] != 0) map.erase(vec[i].ind.id);
+        }
+        auto keep = fillHoles(doomed, removed, [&](std::size_t from, std::size_t to) {
+            vec[to]             = std::move(vec[from]);
+            map[vec[to].ind.id] = to;
+        });
+        vec.erase(vec.begin() + static_cast<std::ptrdiff_t>(keep), vec.end());
+    }
+
+    template <std::ranges::input_range R>
+    std::vector<Ref> insert_range(R&& range) {
+        std::vector<Ref> refs;
+        if constexpr (std::ranges::sized_range<R>) {
+            refs.reserve(std::ranges::size(range));
+            vec.reserve(vec.size() + std::ranges::size(range));
+            map.reserve(vec.size() + std::ranges::size(range));
+        }
+        for (auto&& elem: range) refs.push_back(insert(std::forward<decltype(elem)>(elem)));
+        return refs;
     }
 
     [[nodiscard]] Elem        front() const { return vec.front(); }
@@ -328,10 +387,165 @@ class CompactMap {
     [[nodiscard]] auto cend() const { return vec.cend(); }
 };
 
+// maps ids to dense indicies through an array of slots with no hashing
+// an id packs its slot (low 32 bits) with the slot's generation when it was handed out (high 32
+// bits), freeing a slot bumps its generation so stale ids are detected
+// so at most 2^32 slots, insert throws std::length_error past that (dense indicies never exceed
+// the slot count so they fit too)
+class SlotTable {
+  private:
+    struct Slot {
+        std::uint32_t dense;
+        std::uint32_t gen;
+    };
+    std::vector<Slot>          slots{};
+    std::vector<std::uint32_t> freeSlots{};
+
+    static std::uint32_t slotOf(std::size_t id) { return static_cast<std::uint32_t>(id); }
+    static std::uint32_t genOf(std::size_t id) { return static_cast<std::uint32_t>(id >> 32); }
+
+  public:
+    // id for a new element stored at dense
+    std::size_t insert(std::size_t dense) {
+        std::uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (slots.size() > std::numeric_limits<std::uint32_t>::max())
+                throw std::length_error("SlotTable is out of 32 bit slots");
+            slot = static_cast<std::uint32_t>(slots.size());
+            slots.push_back({});
+        }
+        slots[slot].dense = static_cast<std::uint32_t>(dense);
+        return static_cast<std::size_t>(slots[slot].gen) << 32 | slot;
+    }
+
+    [[nodiscard]] bool contains(std::size_t id) const {
+        return slotOf(id) < slots.size() && slots[slotOf(id)].gen == genOf(id);
+    }
+
+    [[nodiscard]] std::size_t index(std::size_t id) const {
+        if (!contains(id)) throw std::out_of_range("Ref is stale or invalid");
+        return slots[slotOf(id)].dense;
+    }
+
+    // the element of id now lives at dense
+    void move(std::size_t id, std::size_t dense) {
+        slots[slotOf(id)].dense = static_cast<std::uint32_t>(dense);
+    }
+
+    void erase(std::size_t id) {
+        if (!contains(id)) throw std::out_of_range("Ref is stale or invalid");
+        ++slots[slotOf(id)].gen;
+        freeSlots.push_back(slotOf(id));
+    }
+
+    void reserve(std::size_t n) { slots.reserve(n); }
+
+    void clear() { // keeps the slots so every id handed out so far stays stale
+        freeSlots.clear();
+        for (std::size_t s = slots.size(); s-- != 0;) {
+            ++slots[s].gen;
+            freeSlots.push_back(static_cast<std::uint32_t>(s));
+        }
+    }
+};
+
+// CompactMap with refs resolved through a SlotTable, lookup is one array indirection and refs to
+// erased elements throw instead of aliasing
+template <typename T, typename RefTag = DefRefTag>
+class SlotMap {
+  private:
+    using Ref = Ref<T, RefTag>;
+    struct Elem {
+        Ref ind;
+        T   obj;
+    };
+    std::vector<Elem> vec{};
+    SlotTable         slots{};
+
+  public:
+    // if you do not store the return value you will only be able to retrive/delete this element
+    // through iteration
+    template <typename E>
+    Ref insert(E&& elem) { // forwarded
+        Ref ind{slots.insert(vec.size())};
+        vec.emplace_back(ind, std::forward<E>(elem));
+        return ind;
+    }
+    // deletion changes underyling array and therefore invalidates iterators/pointers
+    void erase(const Ref& ind) {
+        auto delIndex = slots.index(ind.id);
+        slots.erase(ind.id);
+        if (delIndex != vec.size() - 1) {
+            vec[delIndex] = std::move(vec.back());
+            slots.move(vec[delIndex].ind.id, delIndex);
+        }
+        vec.pop_back();
+    }
+    // deletion changes underyling array and therefore invalidates iterators-pointers
+    // one compaction pass, O(n + k) however many are removed
+    template <std::ranges::forward_range R>
+        requires std::is_same_v<std::ranges::range_value_t<R>, Ref>
+    void erase(R&& range) {
+        std::vector<std::uint8_t> doomed(vec.size());
+        std::size_t               removed = 0;
+        for (const auto& ind: range) { // all looked up before anything changes
+            auto delIndex = slots.index(ind.id);
+            if (doomed[delIndex] == 0) ++removed;
+            doomed[delIndex] = 1;
+        }
+        for (std::size_t i = 0; i != vec.size(); ++i) {
+            if (doomed[i] != 0) slots.erase(vec[i].ind.id);
+        }
+        auto keep = fillHoles(doomed, removed, [&](std::size_t from, std::size_t to) {
+            vec[to] = std::move(vec[from]);
+            slots.move(vec[to].ind.id, to);
+        });
+        vec.erase(vec.begin() + static_cast<std::ptrdiff_t>(keep), vec.end());
+    }
+
+    template <std::ranges::input_range R>
+    std::vector<Ref> insert_range(R&& range) {
+        std::vector<Ref> refs;
+        if constexpr (std::ranges::sized_range<R>) {
+            refs.reserve(std::ranges::size(range));
+            reserve(vec.size() + std::ranges::size(range));
+        }
+        for (auto&& elem: range) refs.push_back(insert(std::forward<decltype(elem)>(elem)));
+        return refs;
+    }
+
+    [[nodiscard]] Elem        front() const { return vec.front(); }
+    [[nodiscard]] Elem        back() const { return vec.back(); }
+    [[nodiscard]] bool        contains(const Ref& ind) const { return slots.contains(ind.id); }
+    [[nodiscard]] std::size_t size() const { return vec.size(); }
+    [[nodiscard]] bool        empty() const { return vec.empty(); }
+    void                      reserve(std::size_t n) {
+        vec.reserve(n);
+        slots.reserve(n);
+    }
+    void clear() { // invalidates all refs previously made by this object
+        vec.clear();
+        slots.clear();
+    }
+    [[nodiscard]] T&       operator[](const Ref& ind) { return vec[slots.index(ind.id)].obj; }
+    [[nodiscard]] const T& operator[](const Ref& ind) const { return vec[slots.index(ind.id)].obj; }
+
+    [[nodiscard]] auto begin() { return vec.begin(); }
+    [[nodiscard]] auto end() { return vec.end(); }
+    [[nodiscard]] auto begin() const { return vec.cbegin(); }
+    [[nodiscard]] auto end() const { return vec.cend(); }
+    [[nodiscard]] auto cbegin() const { return vec.cbegin(); }
+    [[nodiscard]] auto cend() const { return vec.cend(); }
+};
+
 } // namespace details
 
+// implementation used for the engine's polygons and springs, any of the above fit
 template <typename T, typename RefTag = details::DefRefTag>
-using StableVector = details::CompactMap<T, RefTag>;
+using StableVector = details::SlotMap<T, RefTag>;
 
 } // namespace physenv
 
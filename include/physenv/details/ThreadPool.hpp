@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace physenv::details {
+
+// work stealing pool for data parallel loops
+// parallelFor splits a range into chunks dealt round robin onto per thread deques, every thread
+// (the caller included) works from the back of its own deque and steals from the front of the
+// others once it runs dry
+// one parallelFor runs at a time and bodies must not start another
+// copies don't share threads, a copy starts empty and spawns its own on first use
+class ThreadPool {
+  private:
+    struct Chunk {
+        std::size_t begin, end;
+    };
+    struct Queue {
+        std::mutex        mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_{}; // caller's first then one per worker
+    std::vector<std::jthread>           workers_{};
+    std::mutex                          mutex_{};
+    std::condition_variable             wake_{};
+    std::ptrdiff_t                      queued_ = 0; // guarded by mutex_
+    bool                                stop_   = false;
+
+    // the running parallelFor
+    void (*invoke_)(const void*, std::size_t, std::size_t) = nullptr;
+    const void*              body_                         = nullptr;
+    std::atomic<std::size_t> remaining_{0};
+    std::exception_ptr       error_{};
+    std::mutex               errorMutex_{};
+
+    bool pop(std::size_t self, Chunk& chunk) {
+        for (std::size_t i = 0; i != queues_.size(); ++i) {
+            Queue&           queue = *queues_[(self + i) % queues_.size()];
+            std::scoped_lock lock(queue.mutex);
+            if (queue.chunks.empty()) continue;
+            if (i == 0) { // own work newest first, stolen work oldest first
+                chunk = queue.chunks.back();
+                queue.chunks.pop_back();
+            } else {
+                chunk = queue.chunks.front();
+                queue.chunks.pop_front();
+            }
+            std::scoped_lock count(mutex_);
+            --queued_;
+            return true;
+        }
+        return false;
+    }
+
+    void run(const Chunk& chunk) {
+        try {
+            invoke_(body_, chunk.begin, chunk.end);
+        } catch (...) {
+            std::scoped_lock lock(errorMutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) remaining_.notify_all();
+    }
+
+    void work(std::size_t self) {
+        Chunk chunk{};
+        while (true) {
+            if (pop(self, chunk)) {
+                run(chunk);
+                continue;
+            }
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || queued_ > 0; });
+            if (stop_) return;
+        }
+    }
+
+    void start(std::size_t workers) {
+        stop();
+        queues_.clear();
+        for (std::size_t i = 0; i != workers + 1; ++i) queues_.push_back(std::make_unique<Queue>());
+        for (std::size_t i = 1; i != workers + 1; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::scoped_lock lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        workers_.clear(); // joins
+        stop_ = false;
+    }
+
+  public:
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool& /*other*/) {}
+    ThreadPool& operator=(const ThreadPool& /*other*/) { return *this; }
+    ~ThreadPool() { stop(); }
+
+    // threads including the caller, spawned or joined on the next parallelFor
+    [[nodiscard]] std::size_t threads() const { return workers_.size() + 1; }
+
+    // runs body(begin, end) over [0, count) in chunks of grain with up to threads threads and
+    // returns once every chunk is done, rethrowing the first exception a chunk threw
+    // with one thread (or one chunk) it's a plain serial loop on the caller
+    template <typename F>
+    void parallelFor(std::size_t threads, std::size_t count, std::size_t grain, F&& body) {
+        grain               = std::max(grain, std::size_t{1});
+        const std::size_t n = (count + grain - 1) / grain;
+        if (threads <= 1 || n <= 1) {
+            for (std::size_t b = 0; b < count; b += grain) body(b, std::min(count, b + grain));
+            return;
+        }
+        if (workers_.size() + 1 != threads) start(threads - 1);
+
+        invoke_ = [](const void* f, std::size_t begin, std::size_t end) {
+            using Body = std::remove_reference_t<F>;
+            (*static_cast<Body*>(const_cast<void*>(f)))(begin, end);
+        };
+        body_   = &body;
+        error_  = nullptr;
+        remaining_.store(n, std::memory_order_relaxed);
+        for (std::size_t c = 0; c != n; ++c) {
+            Queue&           queue = *queues_[c % queues_.size()];
+            std::scoped_lock lock(queue.mutex);
+            queue.chunks.push_back({c * grain, std::min(count, (c + 1) * grain)});
+        }
+        {
+            std::scoped_lock lock(mutex_);
+            queued_ += static_cast<std::ptrdiff_t>(n);
+        }
+        wake_.notify_all();
+
+        Chunk chunk{};
+        while (pop(0, chunk)) run(chunk);
+        for (std::size_t left; (left = remaining_.load(std::memory_order_acquire)) != 0;) {
+            remaining_.wait(left, std::memory_order_acquire);
+        }
+        if (error_) std::rethrow_exception(error_);
+    }
+};
+
+} // namespace physenv::details
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "Vector2.hpp"
+
+namespace physenv::details {
+
+struct Aabb {
+    Vec2 min{};
+    Vec2 max{};
+
+    [[nodiscard]] bool contains(const Vec2& pos) const {
+        return pos.x >= min.x && pos.y >= min.y && pos.x <= max.x && pos.y <= max.y;
+    }
+};
+
+// uniform grid bucketing items by their bounding boxes
+// cells are stored as compressed rows (one flat item array + per cell offsets) and items are filled
+// in index order so every cell lists its items ascending
+class UniformGrid {
+  private:
+    Vec2                     origin_{};
+    double                   cellSize_ = 1.0;
+    std::size_t              cols_     = 0;
+    std::size_t              rows_     = 0;
+    std::vector<std::size_t> cellStart_{}; // cells + 1 offsets into items_
+    std::vector<std::size_t> items_{};
+
+    [[nodiscard]] static std::size_t clampCell(double local, std::size_t count) {
+        return static_cast<std::size_t>(
+            std::clamp(std::floor(local), 0.0, static_cast<double>(count - 1)));
+    }
+    [[nodiscard]] std::size_t clampCol(double x) const {
+        return clampCell((x - origin_.x) / cellSize_, cols_);
+    }
+    [[nodiscard]] std::size_t clampRow(double y) const {
+        return clampCell((y - origin_.y) / cellSize_, rows_);
+    }
+
+  public:
+    // bounds(i) returns the Aabb of item i
+    // a cellSize of 0 picks one from the item sizes and density
+    template <typename F>
+    void build(std::size_t count, F&& bounds, double cellSize = 0) {
+        cols_ = rows_ = 0;
+        cellStart_.clear();
+        items_.clear();
+        if (count == 0) return;
+
+        Aabb   world = bounds(0);
+        double extentSum{};
+        for (std::size_t i = 0; i != count; ++i) {
+            Aabb b      = bounds(i);
+            world.min.x = std::min(world.min.x, b.min.x);
+            world.min.y = std::min(world.min.y, b.min.y);
+            world.max.x = std::max(world.max.x, b.max.x);
+            world.max.y = std::max(world.max.y, b.max.y);
+            extentSum += std::max(b.max.x - b.min.x, b.max.y - b.min.y);
+        }
+        Vec2 size = world.max - world.min;
+        if (cellSize <= 0) {
+            double density = std::sqrt(size.x * size.y / static_cast<double>(count));
+            cellSize       = std::max(density, extentSum / static_cast<double>(count));
+        }
+        // cap the cell count so degenerate inputs can't blow up memory
+        double maxSide = std::max(size.x, size.y);
+        double minSize = maxSide / std::sqrt(4.0 * static_cast<double>(count) + 16.0);
+        cellSize_      = std::max({cellSize, minSize, 1e-12});
+        origin_        = world.min;
+        cols_          = static_cast<std::size_t>(size.x / cellSize_) + 1;
+        rows_          = static_cast<std::size_t>(size.y / cellSize_) + 1;
+
+        // counting sort of items into cells
+        cellStart_.assign(cols_ * rows_ + 1, 0);
+        auto forCells = [&](std::size_t i, auto&& fn) {
+            Aabb b = bounds(i);
+            for (std::size_t r = clampRow(b.min.y); r <= clampRow(b.max.y); ++r)
+                for (std::size_t c = clampCol(b.min.x); c <= clampCol(b.max.x); ++c)
+                    fn(r * cols_ + c);
+        };
+        for (std::size_t i = 0; i != count; ++i)
+            forCells(i, [&](std::size_t cell) { ++cellStart_[cell + 1]; });
+        for (std::size_t c = 0; c != cols_ * rows_; ++c) cellStart_[c + 1] += cellStart_[c];
+        items_.resize(cellStart_.back());
+        std::vector<std::size_t> fill(cellStart_.begin(), cellStart_.end() - 1);
+        for (std::size_t i = 0; i != count; ++i)
+            forCells(i, [&](std::size_t cell) { items_[fill[cell]++] = i; });
+    }
+
+    [[nodiscard]] bool        empty() const { return cellStart_.empty(); }
+    [[nodiscard]] double      cellSize() const { return cellSize_; }
+    [[nodiscard]] std::size_t cols() const { return cols_; }
+    [[nodiscard]] std::size_t rows() const { return rows_; }
+
+    [[nodiscard]] std::span<const std::size_t> cell(std::size_t col, std::size_t row) const {
+        std::size_t c = row * cols_ + col;
+        return std::span(items_).subspan(cellStart_[c], cellStart_[c + 1] - cellStart_[c]);
+    }
+
+    // items whose bounds overlap the cell containing pos (empty if outside the grid)
+    [[nodiscard]] std::span<const std::size_t> cellItems(const Vec2& pos) const {
+        if (empty()) return {};
+        Vec2 local = (pos - origin_) / cellSize_;
+        if (!(local.x >= 0 && local.y >= 0 && local.x < static_cast<double>(cols_) &&
+              local.y < static_cast<double>(rows_)))
+            return {};
+        return cell(static_cast<std::size_t>(local.x), static_cast<std::size_t>(local.y));
+    }
+
+    // visits every item in cells overlapping box - items spanning cells are visited more than once
+    template <typename F>
+    void query(const Aabb& box, F&& visit) const {
+        if (empty()) return;
+        for (std::size_t r = clampRow(box.min.y); r <= clampRow(box.max.y); ++r)
+            for (std::size_t c = clampCol(box.min.x); c <= clampCol(box.max.x); ++c)
+                for (std::size_t i: cell(c, r)) visit(i);
+    }
+
+    // searches rings of cells outwards from pos untill no closer item can exist
+    // dist(i) gives the distance from pos to item i
+    // returns {index, distance} or {-1, inf} if the grid is empty
+    template <typename F>
+    std::pair<std::size_t, double> nearest(const Vec2& pos, F&& dist) const {
+        std::pair<std::size_t, double> best{static_cast<std::size_t>(-1),
+                                            std::numeric_limits<double>::infinity()};
+        if (empty()) return best;
+        using Index         = long long;
+        const Index col     = static_cast<Index>(std::floor((pos.x - origin_.x) / cellSize_));
+        const Index row     = static_cast<Index>(std::floor((pos.y - origin_.y) / cellSize_));
+        const Index lastCol = static_cast<Index>(cols_) - 1;
+        const Index lastRow = static_cast<Index>(rows_) - 1;
+        // rings closer than this are all outside the grid
+        const Index first = std::max({Index{}, -col, col - lastCol, -row, row - lastRow});
+        const Index last  = std::max({col, lastCol - col, row, lastRow - row});
+
+        auto visitCell = [&](Index c, Index r) {
+            if (c < 0 || r < 0 || c > lastCol || r > lastRow) return;
+            for (std::size_t i: cell(static_cast<std::size_t>(c), static_cast<std::size_t>(r))) {
+                double d = dist(i);
+                if (d < best.second) best = {i, d};
+            }
+        };
+        for (Index ring = first; ring <= last; ++ring) {
+            for (Index r = std::max(row - ring, Index{}); r <= std::min(row + ring, lastRow); ++r) {
+                if (r == row - ring || r == row + ring) {
+                    Index end = std::min(col + ring, lastCol);
+                    for (Index c = std::max(col - ring, Index{}); c <= end; ++c) visitCell(c, r);
+                } else {
+                    visitCell(col - ring, r);
+                    visitCell(col + ring, r);
+                }
+            }
+            // anything in the next ring is at least ring cells away
+            if (best.second <= static_cast<double>(ring) * cellSize_) break;
+        }
+        return best;
+    }
+};
+
+} // namespace physenv::details
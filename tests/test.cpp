@@ -1,7 +1,11 @@
 #include <numbers>
+#include <numeric>
 #include <ranges>
 
+#include "physenv/Ensemble.hpp"
 #include "physenv/Persistance.hpp"
+#include "physenv/Snapshot.hpp"
+#include "physenv/Trajectory.hpp"
 #include "gtest/gtest.h"
 
 using std::numbers::sqrt2;
@@ -26,7 +30,8 @@ class StableVectors : public testing::Test {
     T vec;
 };
 
-using TestedTypes = testing::Types<details::PepperedVector<int>, details::CompactMap<int>>;
+using TestedTypes =
+    testing::Types<details::PepperedVector<int>, details::CompactMap<int>, details::SlotMap<int>>;
 TYPED_TEST_SUITE(StableVectors, TestedTypes);
 
 TYPED_TEST(StableVectors, IsEmptyIntially) { EXPECT_TRUE(this->vec.empty()); }
@@ -152,6 +157,46 @@ TEST(Point, forceFrame) {
     EXPECT_EQ(p.pos, Vec2(12, 10));
 }
 
+TYPED_TEST(StableVectors, BulkInsertAndErase) {
+    auto& vec  = this->vec;
+    auto  refs = vec.insert_range(std::views::iota(0, 20));
+    ASSERT_EQ(refs.size(), 20);
+    std::vector<std::pair<typename decltype(refs)::value_type, int>> curr;
+    for (int i = 0; i != 20; ++i) curr.emplace_back(refs[static_cast<std::size_t>(i)], i);
+    equalityCheck(vec, curr);
+
+    // includes the trailing elements and a duplicate
+    std::vector<typename decltype(refs)::value_type> removes;
+    for (std::size_t i: {19UL, 0UL, 18UL, 7UL, 8UL, 19UL}) removes.push_back(refs[i]);
+    if constexpr (!std::is_same_v<TypeParam, details::PepperedVector<int>>) { // no dedup there
+        vec.erase(removes);
+        std::erase_if(curr, [](const auto& c) {
+            return c.second == 19 || c.second == 0 || c.second == 18 || c.second == 7 ||
+                   c.second == 8;
+        });
+        equalityCheck(vec, curr);
+    }
+}
+
+TEST(SlotMap, StaleRefsAreDetected) {
+    details::SlotMap<int> vec;
+    auto                  a = vec.insert(1);
+    auto                  b = vec.insert(2);
+    vec.erase(a);
+    auto c = vec.insert(3); // reuses a's slot
+    EXPECT_FALSE(vec.contains(a));
+    EXPECT_THROW(static_cast<void>(vec[a]), std::out_of_range);
+    EXPECT_THROW(vec.erase(a), std::out_of_range);
+    EXPECT_EQ(vec[b], 2);
+    EXPECT_EQ(vec[c], 3);
+    vec.clear();
+    EXPECT_FALSE(vec.contains(b));
+    EXPECT_FALSE(vec.contains(c));
+    auto d = vec.insert(4);
+    EXPECT_EQ(vec.size(), 1);
+    EXPECT_EQ(vec[d], 4);
+}
+
 class EngineTest : public testing::Test {
   protected:
     Engine e = Engine::softbody({5, 5}, {0.0f, 0.0f}, 10.0f, 10.0f, 10.0f, 1.0f);
@@ -184,4 +229,936 @@ TEST_F(EngineTest, SaveAndLoadEngPartial) {
     EXPECT_EQ(e.points.size(), e2.points.size());
     EXPECT_EQ(e2.springs.size(), 0);
     EXPECT_EQ(e2.polys.size(), 0);
+}
+
+TEST(Persistance, TextRoundTripKeepsValues) {
+    std::filesystem::path p = "TextRoundTrip.csv";
+    Engine                e{};
+    auto                  p1 = e.addPoint(Point({0.25, -1.5}, 2.0, {3.0, 0.125}, false));
+    auto                  p2 = e.addPoint(Point({4.0, 1.0 / 3.0}, 0.5, {}, true));
+    e.addSpring(Spring{12.0, 0.75, 3.5, p2, p1});
+    e.polys.insert(Polygon({{0, 0}, {2, 0}, {2, 2}, {0, 2}}));
+    persisitance::saveEng(e, p, {true, true, true});
+
+    Engine e2{};
+    e2.addPoint(Point{});
+    persisitance::loadEng(e2, p, false, {true, true, true});
+    ASSERT_EQ(e2.points.size(), 3);
+    EXPECT_EQ(e2.points.get(1), e.points.get(0));
+    EXPECT_EQ(e2.points.get(2), e.points.get(1));
+    const Spring& s = e2.springs.begin()->obj;
+    EXPECT_EQ(s.springConst, 12.0);
+    EXPECT_EQ(s.dampFact, 0.75);
+    EXPECT_EQ(s.naturalLength, 3.5);
+    EXPECT_EQ(e2.points.index(s.p1), 2);
+    EXPECT_EQ(e2.points.index(s.p2), 1);
+    ASSERT_EQ(e2.polys.size(), 1);
+    EXPECT_EQ(e2.polys.begin()->obj.edges().size(), 4);
+
+    { std::ofstream{p} << persisitance::PointHeaders << "\n0 0 1 2 3 4 5 6\n"; }
+    EXPECT_THROW(persisitance::loadEng(e2, p, true, {true, true, true}), std::runtime_error);
+}
+
+TEST_F(EngineTest, SaveAndLoadSnapshot) {
+    std::filesystem::path p = "SaveAndLoadTest.snap";
+    e.simFrame(0.01);
+    persisitance::saveSnapshot(e, p, {true, true, true});
+    Engine e2{};
+    e2.addPoint(Point{});
+    persisitance::loadSnapshot(e2, p, false, {true, true, true});
+    ASSERT_EQ(e2.points.size(), e.points.size() + 1);
+    ASSERT_EQ(e2.springs.size(), e.springs.size());
+    ASSERT_EQ(e2.polys.size(), e.polys.size());
+    for (std::size_t i = 0; i != e.points.size(); ++i) {
+        EXPECT_EQ(e2.points.get(i + 1), e.points.get(i));
+    }
+    auto s2 = e2.springs.begin();
+    for (const auto& s: e.springs) {
+        EXPECT_EQ(s2->obj.springConst, s.obj.springConst);
+        EXPECT_EQ(s2->obj.naturalLength, s.obj.naturalLength);
+        EXPECT_EQ(s2->obj.dampFact, s.obj.dampFact);
+        EXPECT_EQ(e2.points[s2->obj.p1], e.points[s.obj.p1]);
+        EXPECT_EQ(e2.points[s2->obj.p2], e.points[s.obj.p2]);
+        ++s2;
+    }
+    auto p2 = e2.polys.begin();
+    for (const auto& poly: e.polys) {
+        ASSERT_EQ(p2->obj.edges().size(), poly.obj.edges().size());
+        for (std::size_t i = 0; i != poly.obj.edges().size(); ++i) {
+            EXPECT_EQ(p2->obj.edges()[i].p1(), poly.obj.edges()[i].p1());
+        }
+        ++p2;
+    }
+}
+
+TEST_F(EngineTest, LoadSnapshotRejectsBadFiles) {
+    std::filesystem::path p = "BadSnapshot.snap";
+    persisitance::saveSnapshot(e, p, {true, true, true});
+    std::filesystem::resize_file(p, std::filesystem::file_size(p) / 2);
+    Engine e2{};
+    EXPECT_THROW(persisitance::loadSnapshot(e2, p, true, {true, true, true}), std::runtime_error);
+    { std::ofstream{p} << "not a snapshot, just some text that is long enough to fill a header"; }
+    EXPECT_THROW(persisitance::loadSnapshot(e2, p, true, {true, true, true}), std::runtime_error);
+}
+
+TEST_F(EngineTest, TrajectoryReplaysFrames) {
+    std::filesystem::path          p = "Trajectory.traj";
+    std::vector<std::vector<Vec2>> expected;
+    {
+        persisitance::TrajectoryRecorder rec{e, p, {10, 1E-6, 1E-6}};
+        for (int f = 0; f != 35; ++f) {
+            e.simFrame(0.01);
+            rec.record();
+            expected.emplace_back();
+            for (std::size_t i = 0; i != e.points.size(); ++i) {
+                expected.back().push_back(e.points.pos(i));
+            }
+        }
+    }
+
+    persisitance::TrajectoryReader reader{p};
+    ASSERT_EQ(reader.frames(), 35);
+    std::size_t next = 12;
+    reader.replay(12, 27, [&](const persisitance::TrajectoryFrame& frame) {
+        ASSERT_EQ(frame.frame, next++);
+        for (std::size_t i = 0; i != frame.posX.size(); ++i) {
+            EXPECT_NEAR(frame.posX[i], expected[frame.frame][i].x, 1E-6);
+            EXPECT_NEAR(frame.posY[i], expected[frame.frame][i].y, 1E-6);
+        }
+    });
+    EXPECT_EQ(next, 27);
+    EXPECT_EQ(reader.read(34).posX.size(), e.points.size());
+
+    // without the index the reader falls back to scanning and drops the partial frame
+    std::filesystem::resize_file(p, std::filesystem::file_size(p) - 100);
+    persisitance::TrajectoryReader partial{p};
+    EXPECT_EQ(partial.frames(), 34);
+    EXPECT_NEAR(partial.read(20).posX[3], expected[20][3].x, 1E-6);
+}
+
+TEST_F(EngineTest, SpringAdjacencyTracksEdits) {
+    auto attached = [&](const PointRef& point) {
+        std::vector<SpringRef> refs;
+        for (const auto& s: e.springs) {
+            if (s.obj.p1 == point || s.obj.p2 == point) refs.push_back(s.ind);
+        }
+        return refs;
+    };
+
+    PointRef centre = e.points.ref(12);
+    EXPECT_EQ(e.springsOf(centre).size(), 8);
+    e.rmvSpring(e.springsOf(centre)[3]);
+    EXPECT_EQ(e.springsOf(centre).size(), 7);
+
+    std::vector<PointRef> removed{centre, e.points.ref(0), e.points.ref(13), e.points.ref(24)};
+    for (const auto& point: removed) e.rmvPoint(point);
+    EXPECT_EQ(e.points.size(), 21);
+    for (const auto& point: removed) EXPECT_TRUE(attached(point).empty());
+    for (std::size_t i = 0; i != e.points.size(); ++i) {
+        PointRef point = e.points.ref(i);
+        EXPECT_TRUE(std::ranges::is_permutation(e.springsOf(point), attached(point)));
+    }
+}
+
+TEST(Engine, BulkAddMatchesSingle) {
+    std::vector<Point> pts{Point{{0, 0}, 1.0}, Point{{1, 0}, 2.0}, Point{{0, 1}, 1.0}};
+    std::vector<Engine::LocalSpring> springs{{10, 1, 1, 0, 1}, {10, 1, 1, 1, 2}, {5, 0, 1, 2, 2}};
+    Engine single{9.8};
+    Engine bulk = single;
+    single.addPoint(Point{{5, 5}, 1.0}); // something there already
+    bulk.addPoint(Point{{5, 5}, 1.0});
+
+    std::vector<PointRef> singleRefs;
+    for (const Point& p: pts) singleRefs.push_back(single.addPoint(p));
+    for (const auto& s: springs) {
+        single.addSpring(Spring{s.springConst, s.dampFact, s.naturalLength, singleRefs[s.p1],
+                                singleRefs[s.p2]});
+    }
+    auto refs = bulk.addBulk(pts, springs);
+    ASSERT_EQ(refs.points.size(), 3);
+    ASSERT_EQ(refs.springs.size(), 3);
+    EXPECT_EQ(bulk.points.size(), single.points.size());
+    EXPECT_EQ(bulk.springs.size(), single.springs.size());
+    for (std::size_t i = 0; i != pts.size(); ++i) {
+        EXPECT_EQ(bulk.points[refs.points[i]], pts[i]);
+        EXPECT_EQ(bulk.springsOf(refs.points[i]).size(), single.springsOf(singleRefs[i]).size());
+    }
+    EXPECT_EQ(bulk.springs[refs.springs[1]].p1, refs.points[1]);
+    EXPECT_EQ(bulk.springs[refs.springs[1]].p2, refs.points[2]);
+    for (int i = 0; i != 10; ++i) {
+        single.simFrame(1.0 / 120);
+        bulk.simFrame(1.0 / 120);
+    }
+    for (std::size_t i = 0; i != bulk.points.size(); ++i) {
+        EXPECT_EQ(bulk.points.get(i), single.points.get(i));
+    }
+
+    std::vector<Engine::LocalSpring> bad{{1, 1, 1, 0, 3}};
+    EXPECT_THROW(bulk.addBulk(pts, bad), std::out_of_range);
+    EXPECT_EQ(bulk.points.size(), 4);
+}
+
+// every spring starts at its natural length, whatever the grid's shape
+TEST(Engine, SoftbodyLatticeIsAtRest) {
+    using Size = details::Vector2<std::size_t>;
+    for (Size size: {Size{6, 3}, Size{3, 6}, Size{1, 4}}) {
+        Engine e = Engine::softbody(size, {0.5, 1.0}, 9.8f, 0.25f, 100.0f, 1.0f);
+        EXPECT_EQ(e.points.size(), size.x * size.y);
+        std::size_t expected = 2 * (size.x - 1) * (size.y - 1) + (size.x - 1) * size.y +
+                               size.x * (size.y - 1);
+        EXPECT_EQ(e.springs.size(), expected);
+        for (const auto& s: e.springs) {
+            double length = (e.points.pos(s.obj.p1) - e.points.pos(s.obj.p2)).mag();
+            EXPECT_NEAR(length, s.obj.naturalLength, 1e-6);
+        }
+    }
+}
+
+TEST_F(EngineTest, BulkAndDeferredRemovalMatchSingle) {
+    Engine                single = e;
+    std::vector<PointRef> removed{e.points.ref(3), e.points.ref(12), e.points.ref(13),
+                                  e.points.ref(24)};
+    for (const auto& ref: removed) single.rmvPoint(ref);
+    single.rmvSpring(single.springsOf(single.points.ref(0))[0]);
+
+    Engine bulk = e;
+    bulk.rmvPoints(removed);
+    bulk.rmvSprings(std::vector{bulk.springsOf(bulk.points.ref(0))[0]});
+    EXPECT_EQ(bulk.points.size(), single.points.size());
+    EXPECT_EQ(bulk.springs.size(), single.springs.size());
+
+    Engine deferred = e;
+    for (const auto& ref: removed) deferred.rmvPointDeferred(ref);
+    deferred.rmvPointDeferred(removed[0]); // repeats are ignored
+    deferred.rmvSpringDeferred(deferred.springsOf(deferred.points.ref(0))[0]);
+    deferred.rmvSpringDeferred(deferred.springsOf(removed[1])[0]); // goes with its point anyway
+    EXPECT_EQ(deferred.points.size(), 25);
+    deferred.simFrame(0.01);
+    EXPECT_EQ(deferred.points.size(), single.points.size());
+    EXPECT_EQ(deferred.springs.size(), single.springs.size());
+    for (const auto& s: deferred.springs) {
+        EXPECT_TRUE(deferred.points.contains(s.obj.p1));
+        EXPECT_TRUE(deferred.points.contains(s.obj.p2));
+    }
+}
+
+TEST(PointStore, InsertAndErase) {
+    PointStore            store;
+    std::vector<PointRef> refs;
+    for (int i: std::views::iota(0, 10)) {
+        refs.push_back(store.insert(Point{{static_cast<double>(i), 0}, 1.0 + i}));
+    }
+    store.erase(refs[3]);
+    store.erase(refs[0]);
+    EXPECT_EQ(store.size(), 8);
+    EXPECT_FALSE(store.contains(refs[3]));
+    for (int i: {1, 2, 4, 5, 6, 7, 8, 9}) {
+        auto ref = refs[static_cast<std::size_t>(i)];
+        EXPECT_TRUE(store.contains(ref));
+        EXPECT_EQ(store[ref], (Point{{static_cast<double>(i), 0}, 1.0 + i}));
+        EXPECT_EQ(store.ref(store.index(ref)), ref);
+    }
+}
+
+TEST(PointStore, UpdateMatchesPoint) {
+    PointStore store;
+    Point      free{{10, 10}, 2, {1, 0}};
+    Point      fixed{{0, 0}, 1, {1, 1}, true};
+    free.force   = {1, 1};
+    auto freeRef = store.insert(free);
+    auto fixRef  = store.insert(fixed);
+    free.update(0.5, 1);
+    fixed.update(0.5, 1);
+    store.update(0.5, 1);
+    EXPECT_EQ(store[freeRef], free);
+    EXPECT_EQ(store[fixRef], fixed);
+
+    std::vector<Point> points; // masses and forces where a divide would round differently
+    for (int i = 0; i != 64; ++i) {
+        double d = static_cast<double>(i);
+        Point  p{{d, -d}, 0.3 + 0.7 * d}; // at rest so the rounding isn't absorbed into vel
+        p.force = {std::cos(3 * d) * 7.1, std::sin(5 * d) * 3.3};
+        points.push_back(p);
+    }
+    PointStore many;
+    for (const Point& p: points) many.insert(p);
+    for (Point& p: points) p.update(0.01, 9.8);
+    many.update(0.01, 9.8);
+    for (std::size_t i = 0; i != points.size(); ++i) EXPECT_EQ(many.get(i), points[i]);
+}
+
+TEST_F(EngineTest, ParallelSpringsMatchSerial) {
+    Engine parallel = e;
+    parallel.threads = 4;
+    for (int i = 0; i != 50; ++i) {
+        e.simFrame(0.01);
+        parallel.simFrame(0.01);
+    }
+    for (std::size_t i = 0; i != e.points.size(); ++i) {
+        EXPECT_NEAR(e.points.pos(i).x, parallel.points.pos(i).x, 1e-9);
+        EXPECT_NEAR(e.points.pos(i).y, parallel.points.pos(i).y, 1e-9);
+    }
+}
+
+TEST(UniformGrid, CellItemsAndQuery) {
+    std::vector<details::Aabb> boxes{{{0, 0}, {1, 1}}, {{5, 5}, {6, 6}}, {{0, 0}, {6, 6}}};
+    details::UniformGrid       grid;
+    grid.build(boxes.size(), [&](std::size_t i) { return boxes[i]; });
+    for (std::size_t i = 0; i != boxes.size(); ++i) {
+        auto cell = grid.cellItems((boxes[i].min + boxes[i].max) / 2);
+        EXPECT_TRUE(std::ranges::find(cell, i) != cell.end());
+        EXPECT_TRUE(std::ranges::is_sorted(cell));
+    }
+    EXPECT_TRUE(grid.cellItems({-1, -1}).empty());
+    std::vector<std::size_t> found;
+    grid.query({{5.5, 5.5}, {5.6, 5.6}}, [&](std::size_t i) { found.push_back(i); });
+    EXPECT_TRUE(std::ranges::find(found, 1) != found.end());
+    EXPECT_TRUE(std::ranges::find(found, 0) == found.end());
+}
+
+// convex polygons answer with half planes, which should agree with the ray cast and the sweep for
+// the closest edge everywhere off the edges themselves
+TEST(Polygon, ConvexHalfPlanesMatchRayCast) {
+    std::vector<Vec2> hexagon;
+    for (int i = 0; i != 6; ++i) hexagon.emplace_back(std::cos(i * 1.047), 2 * std::sin(i * 1.047));
+    std::vector<Vec2> reversed(hexagon.rbegin(), hexagon.rend());
+    for (const Polygon& poly: {Polygon::Square({-1, -1}, 0.3), Polygon::Triangle({0, 0}),
+                               Polygon(hexagon), Polygon(reversed)}) {
+        ASSERT_TRUE(poly.isConvex());
+        for (int x = 0; x != 80; ++x) {
+            for (int y = 0; y != 80; ++y) {
+                Vec2 pos{-2.01 + x * 0.1737, -2.03 + y * 0.0611};
+                bool rayCast = false;
+                for (const Edge& edge: poly.edges()) rayCast ^= edge.rayCast(pos);
+                ASSERT_EQ(poly.isContained(pos), rayCast) << pos;
+
+                Vec2 vel{0.3, -0.7};
+                Vec2 hitPos = pos;
+                Vec2 hitVel = vel;
+                ASSERT_EQ(poly.collide(hitPos, hitVel), rayCast);
+                if (!rayCast) continue;
+                Edge closest = poly.edge(0); // the sweep colHandler used to do
+                for (const Edge& edge: poly.edges()) {
+                    if (edge.distToPoint(pos) < closest.distToPoint(pos)) closest = edge;
+                }
+                Vec2 normal = (poly.direction ? 1.0 : -1.0) * closest.normal();
+                Vec2 outPos = pos + normal * closest.distToPoint(pos);
+                Vec2 outVel = vel - 2 * normal.dot(vel) * normal;
+                EXPECT_NEAR(hitPos.x, outPos.x, 1e-12);
+                EXPECT_NEAR(hitPos.y, outPos.y, 1e-12);
+                EXPECT_NEAR(hitVel.x, outVel.x, 1e-12);
+                EXPECT_NEAR(hitVel.y, outVel.y, 1e-12);
+            }
+        }
+    }
+}
+
+TEST(Polygon, EdgeViewsFollowVertices) {
+    Polygon l({{0, 0}, {2, 0}, {2, 1}, {1, 1}, {1, 2}, {0, 2}}); // L shape, not convex
+    EXPECT_FALSE(l.isConvex());
+    EXPECT_TRUE(l.isContained({0.5, 1.5}));
+    EXPECT_FALSE(l.isContained({1.5, 1.5})); // in the notch
+    Vec2 pos{0.5, 1.9};
+    Vec2 vel{0, 1};
+    EXPECT_TRUE(l.collide(pos, vel));
+    EXPECT_NEAR(pos.y, 2, 1e-12);
+    EXPECT_EQ(vel, Vec2(0, -1));
+
+    l.setVertex(0, {-1, -1});
+    EXPECT_EQ(l.min(), Vec2(-1, -1));
+    EXPECT_EQ(l.edges().size(), 6);
+    EXPECT_EQ(l.edges().back().p2(), Vec2(-1, -1)); // the closing edge moved too
+    for (std::size_t i = 0; i != l.size(); ++i) {
+        EXPECT_EQ(l.edge(i).p2(), l.edge((i + 1) % l.size()).p1());
+    }
+}
+
+TEST(Polygon, EdgeIndexMatchesLinearScan) {
+    std::vector<Vec2> terrain; // wavy top surface over a flat bottom, far from convex
+    for (int i = 0; i <= 2000; ++i) {
+        double x = i * 0.05;
+        terrain.emplace_back(x, 5 + std::sin(x * 0.7) + 0.5 * std::sin(x * 3.1));
+    }
+    terrain.emplace_back(100, 0);
+    terrain.emplace_back(0, 0);
+    std::vector<Vec2> circle;
+    for (int i = 0; i != 1000; ++i) {
+        circle.emplace_back(50 * std::cos(i * 0.00628), 50 * std::sin(i * 0.00628) + 3);
+    }
+
+    for (const Polygon& plain: {Polygon(terrain), Polygon(circle)}) {
+        Polygon indexed = plain;
+        indexed.buildIndex();
+        ASSERT_TRUE(indexed.indexed());
+        for (int x = 0; x != 120; ++x) {
+            for (int y = 0; y != 50; ++y) {
+                Vec2 pos{-5.01 + x * 0.9137, -0.03 + y * 0.1611};
+                ASSERT_EQ(indexed.isContained(pos), plain.isContained(pos)) << pos;
+                if (!plain.isContained(pos)) continue;
+
+                auto segmentDist = [&](const Edge& e) {
+                    double t = (pos - e.p1()).dot(e.diff()) / e.diff().dot(e.diff());
+                    t        = std::clamp(t, 0.0, 1.0);
+                    return (pos - (e.p1() + e.diff() * t)).mag();
+                };
+                double closest = std::numeric_limits<double>::infinity();
+                for (const Edge& e: plain.edges()) closest = std::min(closest, segmentDist(e));
+                Vec2 hitPos = pos;
+                Vec2 hitVel = {0.3, -0.7};
+                EXPECT_TRUE(indexed.collide(hitPos, hitVel));
+                bool matched = false; // edges sharing the closest vertex tie
+                for (const Edge& e: plain.edges()) {
+                    if (segmentDist(e) > closest + 1e-12) continue;
+                    Vec2 normal = (plain.direction ? 1.0 : -1.0) * e.normal();
+                    matched |= (hitPos - (pos + normal * e.distToPoint(pos))).mag() < 1e-9;
+                }
+                EXPECT_TRUE(matched) << pos;
+            }
+        }
+    }
+
+    Polygon moved(terrain);
+    moved.buildIndex();
+    moved.setVertex(1000, {50, 20}); // a spike, the index follows
+    EXPECT_TRUE(moved.isContained({50, 15}));
+    moved.clearIndex();
+    EXPECT_TRUE(moved.isContained({50, 15}));
+}
+
+TEST(EngineCollision, BroadPhaseMatchesBruteForce) {
+    Engine e{10};
+    for (int x = 0; x != 10; ++x) {
+        for (int y = 0; y != 10; ++y) {
+            e.polys.insert(Polygon::Triangle(Vec2(x * 3.0, y * 3.0)));
+        }
+    }
+    for (int x = 0; x != 60; ++x) {
+        for (int y = 0; y != 60; ++y) {
+            e.addPoint(Point{{x * 0.5 - 1, y * 0.5 - 1}, 1.0, {0.3, -0.2}});
+        }
+    }
+    PointStore expected = e.points;
+    e.collide();
+    for (const auto& poly: e.polys) {
+        for (std::size_t i = 0; i != expected.size(); ++i) {
+            Point p = expected.get(i);
+            if (poly.obj.isBounded(p.pos) && poly.obj.isContained(p.pos)) {
+                poly.obj.colHandler(p);
+                expected.set(i, p);
+            }
+        }
+    }
+    for (std::size_t i = 0; i != expected.size(); ++i) {
+        EXPECT_EQ(e.points.get(i), expected.get(i));
+    }
+}
+
+TEST_F(EngineTest, PointIndexMatchesLinearScan) {
+    std::vector<Vec2> probes{{0, 0}, {17.3, 22.1}, {-50, 3}, {100, 100}, {20, 20}};
+    std::vector<std::pair<PointRef, double>> linear;
+    for (auto probe: probes) linear.push_back(e.findClosestPoint(probe));
+    auto linearRadius = e.findPointsInRadius({20, 20}, 15);
+
+    e.rebuildPointIndex();
+    for (std::size_t i = 0; i != probes.size(); ++i) {
+        auto indexed = e.findClosestPoint(probes[i]);
+        EXPECT_DOUBLE_EQ(indexed.second, linear[i].second);
+    }
+    auto indexedRadius = e.findPointsInRadius({20, 20}, 15);
+    EXPECT_EQ(indexedRadius.size(), 9);
+    EXPECT_TRUE(std::ranges::is_permutation(indexedRadius, linearRadius));
+    EXPECT_EQ(e.findPointsInBox({-1, -1}, {11, 11}).size(), 4);
+}
+
+TEST_F(EngineTest, PointIndexNotUsedOnceStale) {
+    e.rebuildPointIndex();
+    for (int i = 0; i != 30; ++i) e.simFrame(0.1); // moves every point without reindexing
+    for (Vec2 probe: {Vec2{0, 0}, Vec2{20, -20}, Vec2{40, -45}}) {
+        double closest = std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i != e.points.size(); ++i) {
+            closest = std::min(closest, (e.points.pos(i) - probe).mag());
+        }
+        EXPECT_DOUBLE_EQ(e.findClosestPoint(probe).second, closest);
+    }
+}
+
+TEST_F(EngineTest, SpringIndexMatchesLinearScan) {
+    std::vector<Vec2> probes{{0, 0}, {17.3, 22.1}, {-50, 3}, {100, 100}, {5, 2}};
+    std::vector<std::pair<SpringRef, double>> linear;
+    for (auto probe: probes) linear.push_back(e.findClosestSpring(probe));
+    auto linearRadius = e.findSpringsInRadius({20, 20}, 6);
+
+    e.rebuildSpringIndex();
+    for (std::size_t i = 0; i != probes.size(); ++i) {
+        EXPECT_DOUBLE_EQ(e.findClosestSpring(probes[i]).second, linear[i].second);
+    }
+    auto indexedRadius = e.findSpringsInRadius({20, 20}, 6);
+    EXPECT_EQ(indexedRadius.size(), 8);
+    EXPECT_TRUE(std::ranges::is_permutation(indexedRadius, linearRadius));
+    EXPECT_DOUBLE_EQ(e.findClosestSpring({5, 2}).second, 2);
+}
+
+TEST_F(EngineTest, SpringIndexNotUsedOnceStale) {
+    e.rebuildSpringIndex();
+    for (int i = 0; i != 30; ++i) e.simFrame(0.1); // moves every spring without reindexing
+    for (Vec2 probe: {Vec2{0, 0}, Vec2{20, -20}, Vec2{40, -45}}) {
+        double closest = std::numeric_limits<double>::infinity();
+        for (const auto& s: e.springs) {
+            closest = std::min(closest, probe.distToLine(e.points.pos(s.obj.p1),
+                                                         e.points.pos(s.obj.p2)));
+        }
+        EXPECT_DOUBLE_EQ(e.findClosestSpring(probe).second, closest);
+    }
+}
+
+TEST(SpringKernel, SimdMatchesScalar) {
+    Engine e = Engine::softbody({7, 7}, {0.0f, 0.0f}, 10.0f, 1.0f, 100.0f, 2.0f);
+    for (std::size_t i = 0; i != e.points.size(); ++i) { // perturb so every spring is stretched
+        double d = static_cast<double>(i);
+        e.points.setPos(i, e.points.pos(i) + Vec2(std::sin(d), std::cos(3 * d)) * 0.1);
+        e.points.setVel(i, Vec2(std::cos(d), std::sin(2 * d)));
+    }
+    e.points.setPos(1, e.points.pos(0)); // spring 2 joins them, 0 length gives 0 force not nan
+    details::SpringArrays<double> springs;
+    springs.resize(e.springs.size());
+    std::size_t s = 0;
+    for (const auto& spring: e.springs) {
+        springs.p1[s]            = e.points.index(spring.obj.p1);
+        springs.p2[s]            = e.points.index(spring.obj.p2);
+        springs.springConst[s]   = spring.obj.springConst;
+        springs.dampFact[s]      = spring.obj.dampFact;
+        springs.naturalLength[s] = spring.obj.naturalLength;
+        ++s;
+    }
+    ASSERT_EQ(springs.p1[2], 0);
+    ASSERT_EQ(springs.p2[2], 1);
+    details::PointArrays<double> pts{e.points.posX().data(), e.points.posY().data(),
+                                     e.points.velX().data(), e.points.velY().data()};
+    std::size_t                  n = springs.p1.size();
+    std::vector<double>          fx(n);
+    std::vector<double>          fy(n);
+    details::springForcesScalar(pts, springs, 0, n, fx.data(), fy.data());
+    s = 0;
+    for (const auto& spring: e.springs) { // scalar kernel is exactly Spring::forceCalc
+        Vec2 f = spring.obj.forceCalc(e.points[spring.obj.p1], e.points[spring.obj.p2]);
+        EXPECT_EQ(f, Vec2(fx[s], fy[s]));
+        ++s;
+    }
+
+    auto saved = details::simdLevel();
+    for (auto level: {details::SimdLevel::Avx2, details::SimdLevel::Avx512}) {
+        if (level > saved) continue; // not supported here
+        details::setSimdLevel(level);
+        std::vector<double> vx(n);
+        std::vector<double> vy(n);
+        details::springForces(pts, springs, 1, n, vx.data(), vy.data()); // misaligned start
+        for (std::size_t i = 1; i != n; ++i) {
+            EXPECT_NEAR(vx[i - 1], fx[i], 1e-9);
+            EXPECT_NEAR(vy[i - 1], fy[i], 1e-9);
+        }
+        EXPECT_EQ(vx[1], 0); // the 0 length spring
+        EXPECT_EQ(vy[1], 0);
+    }
+    details::setSimdLevel(saved);
+
+    // can't be raised past what the cpu supports
+    EXPECT_EQ(details::setSimdLevel(details::SimdLevel::Avx512), details::detectSimd());
+    details::setSimdLevel(saved);
+    EXPECT_EQ(details::simdLevel(), saved);
+}
+
+TEST(PointKernel, SimdMatchesScalar) {
+    PointStore scalar;
+    for (int i = 0; i != 37; ++i) {
+        double d = static_cast<double>(i);
+        Point  p{{d, -d}, 1.0 + d, {std::sin(d), std::cos(d)}, i % 3 == 0};
+        p.force = {std::cos(2 * d), std::sin(3 * d)};
+        scalar.insert(p);
+    }
+    auto saved = details::simdLevel();
+    for (auto level: {details::SimdLevel::Avx2, details::SimdLevel::Avx512}) {
+        if (level > saved) continue; // not supported here
+        details::setSimdLevel(level);
+        PointStore simd      = scalar;
+        details::integrate(simd.state(), 1, simd.size(), 0.1, 9.8); // misaligned start
+        PointStore expected = scalar;
+        details::integrateScalar(expected.state(), 1, expected.size(), 0.1, 9.8);
+        for (std::size_t i = 0; i != scalar.size(); ++i) {
+            EXPECT_EQ(simd.get(i), expected.get(i));
+        }
+    }
+    details::setSimdLevel(saved);
+}
+
+// one free point on a spring to a fixed anchor, undamped so x(t) = 1 + 0.5 cos(t)
+static double oscillatorError(Integrator integrator, double deltaTime) {
+    Engine e{0};
+    e.integrator = integrator;
+    auto anchor  = e.addPoint(Point{{0, 0}, 1.0, {}, true});
+    auto bob     = e.addPoint(Point{{1.5, 0}, 1.0});
+    e.addSpring(Spring{1.0, 0.0, 1.0, anchor, bob});
+    double time = 0;
+    double err  = 0;
+    while (time < 10) {
+        e.simFrame(deltaTime);
+        time += deltaTime;
+        err = std::max(err, std::abs(e.points.pos(bob).x - (1 + 0.5 * std::cos(time))));
+    }
+    EXPECT_EQ(e.points.pos(anchor), Vec2(0, 0));
+    return err;
+}
+
+TEST(Integrators, ConvergeOnHarmonicOscillator) {
+    double euler  = oscillatorError(Integrator::SemiImplicitEuler, 0.01);
+    double verlet = oscillatorError(Integrator::VelocityVerlet, 0.01);
+    double rk4    = oscillatorError(Integrator::RK4, 0.01);
+    EXPECT_LT(verlet, euler);
+    EXPECT_LT(rk4, verlet);
+    EXPECT_LT(verlet, 1e-4);
+    EXPECT_LT(rk4, 1e-8);
+    // rk4 with a 10x step still beats euler
+    EXPECT_LT(oscillatorError(Integrator::RK4, 0.1), euler);
+}
+
+TEST(DeltaKernel, SimdMatchesScalar) {
+    std::vector<double> values;
+    std::vector<double> prev;
+    for (int i = 0; i != 45; ++i) {
+        double d = static_cast<double>(i);
+        values.push_back(std::sin(d) * 1E3);
+        prev.push_back(std::cos(d) * 1E3);
+    }
+    std::vector<double>       expectedPrev = prev;
+    std::vector<std::int32_t> expectedQ(values.size());
+    double max = details::quantizeDeltasScalar(values.data(), expectedPrev.data(), expectedQ.data(),
+                                               0, values.size(), 1E-3);
+    std::vector<std::int16_t> expectedNarrow(values.size());
+    details::narrowScalar(expectedQ.data(), expectedNarrow.data(), 0, values.size());
+    EXPECT_EQ(max, std::ranges::max(expectedQ | std::views::transform([](std::int32_t q) {
+                                        return std::abs(static_cast<double>(q));
+                                    })));
+    if (details::simdLevel() == details::SimdLevel::Scalar) return;
+
+    std::vector<std::int32_t> q(values.size());
+    EXPECT_EQ(details::quantizeDeltas(values.data(), prev.data(), q.data(), 0, values.size(), 1E-3),
+              max);
+    EXPECT_EQ(prev, expectedPrev);
+    EXPECT_EQ(q, expectedQ);
+    for (auto& v: q) v /= 100; // fits in int16
+    for (auto& v: expectedQ) v /= 100;
+    std::vector<std::int16_t> narrow(values.size());
+    details::narrow(q.data(), narrow.data(), 0, q.size());
+    details::narrowScalar(expectedQ.data(), expectedNarrow.data(), 0, values.size());
+    EXPECT_EQ(narrow, expectedNarrow);
+    values[7] = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_TRUE(std::isnan(details::quantizeDeltas(values.data(), prev.data(), q.data(), 0,
+                                                   values.size(), 1E-3)));
+}
+
+TEST(Stepping, FixedStepAccumulates) {
+    Engine e{10};
+    e.addPoint(Point{{0, 0}, 1.0});
+    e.stepping.fixedDeltaTime = 0.01;
+    e.stepping.substeps       = 3;
+    auto result               = e.step(0.025);
+    EXPECT_EQ(result.steps, 2);
+    EXPECT_EQ(result.substeps, 6);
+    EXPECT_NEAR(result.alpha, 0.5, 1e-9);
+    result = e.step(0.005); // picks up the carried half step
+    EXPECT_EQ(result.steps, 1);
+    EXPECT_NEAR(result.alpha, 0, 1e-9);
+
+    e.stepping.maxSteps = 4;
+    result              = e.step(1.0);
+    EXPECT_EQ(result.steps, 4);
+    EXPECT_NEAR(result.dropped + result.alpha * 0.01, 0.96, 1e-9);
+    EXPECT_LT(result.alpha, 1);
+}
+
+TEST(Stepping, AdaptiveFollowsSpeed) {
+    Engine e{0};
+    auto   p                  = e.addPoint(Point{{0, 0}, 1.0});
+    e.stepping.fixedDeltaTime = 0.1;
+    e.stepping.adaptive       = true;
+    e.stepping.maxMove        = 0.01;
+    EXPECT_EQ(e.step(0.1).substeps, 1); // at rest
+    e.points.setVel(e.points.index(p), {1, 0});
+    EXPECT_EQ(e.step(0.1).substeps, 10);
+    e.points.setVel(e.points.index(p), {1000, 0});
+    EXPECT_EQ(e.step(0.1).substeps, e.stepping.maxSubsteps);
+}
+
+TEST(Stepping, BadSettingsThrowWithoutPoisoning) {
+    Engine e{0};
+    e.addPoint(Point{{0, 0}, 1.0});
+    for (double bad: {0.0, -0.1, std::numeric_limits<double>::quiet_NaN()}) {
+        e.stepping.fixedDeltaTime = bad;
+        EXPECT_THROW(e.step(0.1), std::invalid_argument);
+    }
+    e.stepping.fixedDeltaTime = 0.1;
+    e.stepping.adaptive       = true;
+    e.stepping.maxMove        = 0;
+    EXPECT_THROW(e.step(0.1), std::invalid_argument);
+
+    e.stepping.maxMove = 0.01; // fixed settings step as if the bad calls never happened
+    StepResult result  = e.step(0.25);
+    EXPECT_EQ(result.steps, 2);
+    EXPECT_DOUBLE_EQ(result.alpha, 0.5);
+}
+
+TEST(Profiler, CountsPhasesPerFrame) {
+    static_assert(Profiler::enabled, "tests are built with PHYSENV_PROFILE");
+    Engine e{0};
+    e.profiler = Profiler{4};
+    e.polys.insert(Polygon::Triangle({0, 0}));
+    e.polys.insert(Polygon::Triangle({10, 0}));
+    auto p1 = e.addPoint(Point{{0, 0.5}, 1.0}); // inside the first triangle
+    auto p2 = e.addPoint(Point{{3, 3}, 1.0});
+    e.addSpring(Spring{1.0, 0.1, 4.0, p1, p2});
+    e.simFrame(0.01);
+
+    ProfileSnapshot snap = e.profiler.snapshot();
+    EXPECT_EQ(snap.frames, 1);
+    EXPECT_EQ(snap.last.counters.springs, 1);
+    EXPECT_EQ(snap.last.counters.collisions, 1);
+    EXPECT_GE(snap.last.counters.containmentChecks, 1);
+    EXPECT_GE(snap.last.counters.boundedChecks, snap.last.counters.containmentChecks);
+    EXPECT_GT(snap.last.time(Phase::Springs), 0);
+    EXPECT_GT(snap.last.time(Phase::NarrowPhase), 0);
+    EXPECT_NEAR(snap.last.total(), snap.mean.total(), 1e-12);
+
+    // rk4 evaluates the springs four times, the window keeps the latest 4 frames
+    e.integrator = Integrator::RK4;
+    for (int i = 0; i != 6; ++i) e.simFrame(0.01);
+    snap = e.profiler.snapshot();
+    EXPECT_EQ(snap.frames, 4);
+    EXPECT_EQ(snap.last.counters.springs, 4);
+    EXPECT_EQ(snap.max.counters.springs, 4);
+    std::size_t visited = 0;
+    e.profiler.forEachFrame([&](const FrameStats& frame) {
+        EXPECT_LE(frame.time(Phase::Springs), snap.max.time(Phase::Springs));
+        ++visited;
+    });
+    EXPECT_EQ(visited, 4);
+
+    e.profiler.reset();
+    EXPECT_EQ(e.profiler.snapshot().frames, 0);
+}
+
+TEST(Sleeping, RestingIslandsSleepAndWake) {
+    Engine e = Engine::softbody({3, 3}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+    e.polys.clear();
+    e.polys.insert(Polygon::Square({-5, -1}, 0)); // floor under the body
+    PointRef body  = e.points.ref(0);
+    PointRef loner = e.addPoint(Point{{50, 0}, 1.0}); // falls forever so never rests
+    e.sleeping.enabled = true;
+    auto settle        = [&] {
+        for (int i = 0; i != 5000 && !e.isAsleep(body); ++i) e.simFrame(1.0 / 120);
+    };
+    settle();
+    ASSERT_TRUE(e.isAsleep(body));
+    EXPECT_FALSE(e.isAsleep(loner));
+    EXPECT_EQ(e.sleepingIslands(), 1);
+
+    // asleep the body is skipped entirely
+    std::vector<double> posY(e.points.posY().begin(), e.points.posY().end() - 1);
+    for (int i = 0; i != 10; ++i) e.simFrame(1.0 / 120);
+    EXPECT_TRUE(std::ranges::equal(posY, e.points.posY().first(posY.size())));
+    EXPECT_EQ(e.profiler.snapshot().last.counters.springs, 0);
+
+    // wake on contact
+    e.points.forceX()[e.points.index(body)] = 1;
+    e.simFrame(1.0 / 120);
+    EXPECT_FALSE(e.isAsleep(body));
+    EXPECT_EQ(e.profiler.snapshot().last.counters.springs, e.springs.size());
+
+    // editing another island leaves it asleep, editing its springs wakes it
+    settle();
+    ASSERT_TRUE(e.isAsleep(body));
+    e.rmvPoint(loner);
+    e.simFrame(1.0 / 120);
+    EXPECT_TRUE(e.isAsleep(body));
+    e.rmvSpring(e.springsOf(body).front());
+    EXPECT_FALSE(e.isAsleep(body));
+    e.simFrame(1.0 / 120);
+    EXPECT_FALSE(e.isAsleep(body));
+
+    settle();
+    e.sleeping.enabled = false;
+    e.simFrame(1.0 / 120);
+    EXPECT_EQ(e.sleepingIslands(), 0);
+    EXPECT_FALSE(e.isAsleep(body));
+}
+
+TEST(ThreadPool, ParallelForCoversRangeOnce) {
+    details::ThreadPool pool;
+    std::vector<int>    hits(1000);
+    pool.parallelFor(4, hits.size(), 7, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) ++hits[i];
+    });
+    EXPECT_EQ(pool.threads(), 4);
+    EXPECT_TRUE(std::ranges::all_of(hits, [](int h) { return h == 1; }));
+    EXPECT_THROW(pool.parallelFor(4, 100, 1,
+                                  [](std::size_t begin, std::size_t) {
+                                      if (begin == 42) throw std::runtime_error("chunk");
+                                  }),
+                 std::runtime_error);
+    details::ThreadPool copy = pool; // gets its own threads
+    EXPECT_EQ(copy.threads(), 1);
+}
+
+TEST(Parallel, PhasesMatchSerial) {
+    for (Integrator integrator:
+         {Integrator::SemiImplicitEuler, Integrator::VelocityVerlet, Integrator::RK4}) {
+        Engine serial = Engine::softbody({20, 20}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+        serial.polys.insert(Polygon::Square({-5, -1}, 0));
+        serial.integrator = integrator;
+        Engine parallel   = serial;
+        parallel.threads  = 4;
+        parallel.grains   = {.points = 16, .collide = 8, .queries = 3};
+        for (int i = 0; i != 100; ++i) {
+            serial.simFrame(1.0 / 120);
+            parallel.simFrame(1.0 / 120);
+        }
+        for (std::size_t i = 0; i != serial.points.size(); ++i) {
+            EXPECT_NEAR(serial.points.pos(i).x, parallel.points.pos(i).x, 1e-9);
+            EXPECT_NEAR(serial.points.pos(i).y, parallel.points.pos(i).y, 1e-9);
+        }
+    }
+
+    Engine e  = Engine::softbody({20, 20}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+    e.threads = 4;
+    e.grains  = {.points = 16, .collide = 8, .queries = 3};
+    std::vector<Vec2> probes;
+    for (int i = 0; i != 50; ++i) probes.emplace_back(0.4 + i * 0.02, 0.9 + i * 0.03);
+    auto closestPoints  = e.findClosestPoints(probes);
+    auto closestSprings = e.findClosestSprings(probes);
+    for (std::size_t i = 0; i != probes.size(); ++i) {
+        EXPECT_EQ(closestPoints[i], e.findClosestPoint(probes[i]));
+        EXPECT_EQ(closestSprings[i], e.findClosestSpring(probes[i]));
+    }
+    EXPECT_TRUE(e.findClosestPoints({}).empty());
+}
+
+TEST(Ensemble, MembersMatchSeparateEngines) {
+    Engine prototype = Engine::softbody({6, 6}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+    prototype.polys.insert(Polygon::Square({-5, -1}, 0));
+    std::vector<MemberParams> params{{},
+                                     {.gravity = 4.0},
+                                     {.springScale = 2, .dampScale = 0.5},
+                                     {.gravity = 15, .dampScale = 3}};
+    Ensemble ensemble(prototype, params);
+    ensemble.threads = 3;
+
+    ASSERT_EQ(ensemble.size(), params.size());
+    ASSERT_TRUE(ensemble.geometry());
+    EXPECT_EQ(ensemble.geometry()->size(), 3);
+    for (const Engine& member: ensemble) {
+        EXPECT_TRUE(member.polys.empty());
+        EXPECT_EQ(member.sharedPolys, ensemble.geometry()); // one copy of the geometry
+    }
+
+    std::vector<Engine> separate;
+    for (const MemberParams& p: params) {
+        Engine& e = separate.emplace_back(prototype);
+        if (p.gravity) e.gravity = *p.gravity;
+        for (auto& spring: e.springs) {
+            spring.obj.springConst *= p.springScale;
+            spring.obj.dampFact *= p.dampScale;
+        }
+    }
+    for (int i = 0; i != 120; ++i) {
+        ensemble.simFrame(1.0 / 120);
+        for (Engine& e: separate) e.simFrame(1.0 / 120);
+    }
+    for (std::size_t m = 0; m != params.size(); ++m) {
+        ASSERT_EQ(ensemble[m].points.size(), separate[m].points.size());
+        for (std::size_t i = 0; i != separate[m].points.size(); ++i) {
+            EXPECT_DOUBLE_EQ(ensemble[m].points.pos(i).x, separate[m].points.pos(i).x);
+            EXPECT_DOUBLE_EQ(ensemble[m].points.pos(i).y, separate[m].points.pos(i).y);
+        }
+    }
+
+    auto energies = ensemble.collect([](const Engine& e) { return e.kineticEnergy(); });
+    auto stats    = ensemble.stats(&Engine::kineticEnergy);
+    auto [lo, hi] = std::ranges::minmax_element(energies);
+    EXPECT_EQ(stats.min, *lo);
+    EXPECT_EQ(stats.max, *hi);
+    EXPECT_EQ(stats.argMin, static_cast<std::size_t>(lo - energies.begin()));
+    EXPECT_EQ(stats.argMax, static_cast<std::size_t>(hi - energies.begin()));
+    EXPECT_NEAR(stats.mean, std::accumulate(energies.begin(), energies.end(), 0.0) / 4, 1e-12);
+    EXPECT_GT(stats.stddev, 0);
+
+    auto results = ensemble.step(1.0 / 60);
+    ASSERT_EQ(results.size(), params.size());
+    for (const StepResult& r: results) EXPECT_EQ(r.steps, 2);
+}
+
+TEST(Float, KernelsMatchScalar) {
+    EngineF e = EngineF::softbody({7, 7}, {0.0f, 0.0f}, 10.0f, 1.0f, 100.0f, 2.0f);
+    for (std::size_t i = 0; i != e.points.size(); ++i) { // perturb so every spring is stretched
+        float d = static_cast<float>(i);
+        e.points.setPos(i, e.points.pos(i) + Vec2F(std::sin(d), std::cos(3 * d)) * 0.1f);
+        e.points.setVel(i, Vec2F(std::cos(d), std::sin(2 * d)));
+        e.points.forceX()[i] = std::cos(2 * d);
+    }
+    e.points.setPos(1, e.points.pos(0)); // spring 2 joins them, 0 length gives 0 force not nan
+    details::SpringArrays<float> springs;
+    springs.resize(e.springs.size());
+    std::size_t s = 0;
+    for (const auto& spring: e.springs) {
+        springs.p1[s]            = e.points.index(spring.obj.p1);
+        springs.p2[s]            = e.points.index(spring.obj.p2);
+        springs.springConst[s]   = spring.obj.springConst;
+        springs.dampFact[s]      = spring.obj.dampFact;
+        springs.naturalLength[s] = spring.obj.naturalLength;
+        ++s;
+    }
+    ASSERT_EQ(springs.p1[2], 0);
+    ASSERT_EQ(springs.p2[2], 1);
+    details::PointArrays<float> pts{e.points.posX().data(), e.points.posY().data(),
+                                    e.points.velX().data(), e.points.velY().data()};
+    std::size_t                 n = springs.p1.size();
+    std::vector<float>          fx(n);
+    std::vector<float>          fy(n);
+    details::springForcesScalar(pts, springs, 0, n, fx.data(), fy.data());
+
+    auto saved = details::simdLevel();
+    for (auto level: {details::SimdLevel::Avx2, details::SimdLevel::Avx512}) {
+        if (level > saved) continue; // not supported here
+        details::setSimdLevel(level);
+        std::vector<float> vx(n);
+        std::vector<float> vy(n);
+        details::springForces(pts, springs, 1, n, vx.data(), vy.data()); // misaligned start
+        for (std::size_t i = 1; i != n; ++i) {
+            EXPECT_NEAR(vx[i - 1], fx[i], 1e-3f * (1 + std::abs(fx[i])));
+            EXPECT_NEAR(vy[i - 1], fy[i], 1e-3f * (1 + std::abs(fy[i])));
+        }
+        EXPECT_EQ(vx[1], 0); // the 0 length spring
+        EXPECT_EQ(vy[1], 0);
+
+        PointStoreF simd = e.points;
+        details::integrate(simd.state(), 1, simd.size(), 0.1f, 9.8f);
+        PointStoreF expected = e.points;
+        details::integrateScalar(expected.state(), 1, expected.size(), 0.1f, 9.8f);
+        for (std::size_t i = 0; i != simd.size(); ++i) EXPECT_EQ(simd.get(i), expected.get(i));
+    }
+    details::setSimdLevel(saved);
+}
+
+// float drifts from double by rounding alone, a settling body stays within a fraction of its gap
+TEST(Float, EngineTracksDouble) {
+    Engine  full   = Engine::softbody({10, 10}, {0.5, 1.0}, 9.8f, 0.05f, 100.0f, 1.0f);
+    EngineF single = EngineF::softbody({10, 10}, {0.5f, 1.0f}, 9.8f, 0.05f, 100.0f, 1.0f);
+    ASSERT_EQ(full.points.size(), single.points.size());
+    ASSERT_EQ(full.springs.size(), single.springs.size());
+    for (int i = 0; i != 120; ++i) {
+        full.simFrame(1.0 / 120);
+        single.simFrame(1.0f / 120);
+    }
+    for (std::size_t i = 0; i != full.points.size(); ++i) {
+        EXPECT_NEAR(full.points.pos(i).x, single.points.pos(i).x, 5e-3);
+        EXPECT_NEAR(full.points.pos(i).y, single.points.pos(i).y, 5e-3);
+    }
+    EXPECT_EQ(single.findClosestPoint(single.points.pos(7)).first, single.points.ref(7));
 }
\ No newline at end of file